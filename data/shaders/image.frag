@@ -3,10 +3,21 @@
 in vec2 uv;
 out vec4 color;
 
-uniform sampler2D texSampler;
+layout(binding = 0) uniform sampler2D texSampler;
+layout(binding = 1) uniform usampler2D indexSampler;   // Indices of a paletted texture
+layout(binding = 2) uniform sampler2D paletteSampler;  // 256x1 palette of a paletted texture
+uniform bool paletted = false;
 uniform float blendAlpha = 1.0f;
 void main()
 {
-    color = texture(texSampler, uv);
+    if(paletted)
+    {
+        uint index = texture(indexSampler, uv).r;
+        color = texelFetch(paletteSampler, ivec2(index, 0), 0);
+    }
+    else
+    {
+        color = texture(texSampler, uv);
+    }
     color.a = blendAlpha;
 }
@@ -0,0 +1,170 @@
+/** @file
+ *  Hash index mapping virtual file paths to their location in the sub-arcs.
+ *
+ *  @see @ref arc-files
+ *
+ *  @copyright 2016-2019 Palm Studios
+ */
+#ifndef SH3_ARC_FILE_INDEX_HPP_INCLUDED
+#define SH3_ARC_FILE_INDEX_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "SH3/arc/file_table.hpp"
+#include "SH3/arc/subarc.hpp"
+
+namespace sh3 { namespace arc {
+
+    /**
+     *  Open-addressing (linear probing) hash table from a file path to the @ref subarc containing it.
+     *
+     *  The table is kept at most half full, so a lookup usually resolves with a single probe.
+     *
+     *  Like a @ref file_table, the slots refer to the paths by their offset in a string arena. So an index either
+     *  owns its slots (when it is built by @ref Insert), or views slots that were stored along with their arena,
+     *  e.g. in the @ref mft_cache.
+     *
+     *  @note The paths are not copied, so the string arena must outlive this index.
+     */
+    class file_index final
+    {
+    public:
+        using hash_t = std::uint64_t;   /**< Hash of a file path. */
+        using subarc_id = std::uint16_t; /**< Position of a @ref subarc in @ref mft::subarcs. */
+
+        static constexpr subarc_id noSubarc = 0xFFFF; /**< @ref entry::subarc of an empty slot. */
+
+        /**
+         *  A slot in the hash table.
+         */
+        struct entry final
+        {
+            hash_t          hash;       /**< Hash of the path. */
+            std::uint32_t   name;       /**< Offset of the path in the string arena. */
+            std::uint16_t   nameLength; /**< Length of the path. */
+            subarc_id       subarc;     /**< The @ref subarc the file is located in, or @ref noSubarc if this slot is empty. */
+            subarc::index_t index;      /**< The @ref subarc::index_t of the file. */
+        };
+
+    public:
+        /**
+         *  Constructor. Creates an empty index without an arena.
+         */
+        file_index() = default;
+
+        /**
+         *  Constructor. Creates an empty index to @ref Insert files into.
+         *
+         *  @param arena The string arena of the @ref file_table "file_tables" the files are inserted from.
+         */
+        explicit file_index(const char* arena) : arena(arena) {}
+
+        /**
+         *  Constructor. Views slots stored elsewhere.
+         *
+         *  @param arena    The string arena the @ref entry::name "names" refer to.
+         *  @param slots    The slots. Their number must be a power of two, and at least one of them must be empty.
+         *  @param numSlots Number of @p slots.
+         *  @param count    Number of occupied @p slots.
+         */
+        file_index(const char* arena, const entry* slots, std::size_t numSlots, std::size_t count)
+            : arena(arena), slots(slots), numSlots(numSlots), count(count) {}
+
+        file_index(const file_index&) = delete;
+        file_index(file_index&&) = default;
+        file_index& operator=(const file_index&) = delete;
+        file_index& operator=(file_index&&) = default;
+
+        /**
+         *  Hash a file path (64-bit FNV-1a).
+         *
+         *  @param str The path.
+         *
+         *  @returns The hash of @p str.
+         */
+        static hash_t Hash(std::string_view str) noexcept;
+
+        /**
+         *  Make room for @p numFiles entries without rehashing.
+         *
+         *  @param numFiles The total number of files that will be inserted.
+         */
+        void Reserve(std::size_t numFiles);
+
+        /**
+         *  Add a file to the index.
+         *
+         *  If a file with the same path is already indexed, the existing entry is kept.
+         *  This preserves the behaviour of searching the subarcs in order and using the first match.
+         *
+         *  @param record The file. Its path has to be in the arena this index was constructed with.
+         *  @param subarc The @ref subarc the file is located in.
+         *
+         *  @returns @c true if the file was inserted, @c false if it was already present.
+         */
+        bool Insert(const file_record& record, subarc_id subarc);
+
+        /**
+         *  Look up a file.
+         *
+         *  @param name Path of the file.
+         *
+         *  @returns The @ref entry for @p name, or @c nullptr if it is not indexed.
+         */
+        const entry* Find(std::string_view name) const;
+
+        /**
+         *  Get the path of a file.
+         *
+         *  @param e An occupied entry of this index.
+         *
+         *  @returns A view into the string arena.
+         */
+        std::string_view GetName(const entry& e) const { return std::string_view(arena + e.name, e.nameLength); }
+
+        /**
+         *  Get the number of indexed files.
+         */
+        std::size_t GetSize() const { return count; }
+
+        /**
+         *  Get the number of slots, including the empty ones.
+         */
+        std::size_t GetCapacity() const { return numSlots; }
+
+        /**
+         *  Get the slots, e.g. to store them.
+         */
+        const entry* GetSlots() const { return slots; }
+
+    private:
+        /**
+         *  Find the slot for @p name, which is either its entry or the empty slot to insert it at.
+         *
+         *  @param name Path of the file.
+         *  @param hash @ref Hash of @p name.
+         *
+         *  @returns The index of the slot in @ref slots.
+         */
+        std::size_t Probe(std::string_view name, hash_t hash) const;
+
+        /**
+         *  Resize the table to @p capacity slots and re-insert all entries.
+         *
+         *  @param capacity The new number of slots. Must be a power of two.
+         */
+        void Rehash(std::size_t capacity);
+
+        const char*        arena = nullptr; /**< The string arena. */
+        std::vector<entry> storage;         /**< The slots, if this index owns them. */
+        const entry*       slots = nullptr; /**< The hash table: either @ref storage, or slots viewed elsewhere. */
+        std::size_t        numSlots = 0;    /**< Number of @ref slots. Always zero or a power of two. */
+        std::size_t        count = 0;       /**< Number of occupied @ref slots. */
+    };
+
+} }
+
+#endif // SH3_ARC_FILE_INDEX_HPP_INCLUDED
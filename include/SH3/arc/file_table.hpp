@@ -0,0 +1,86 @@
+/** @file
+ *  Compact, sorted list of the files in a sub-arc.
+ *
+ *  @see @ref arc-files
+ *
+ *  @copyright 2016-2019 Palm Studios
+ */
+#ifndef SH3_ARC_FILE_TABLE_HPP_INCLUDED
+#define SH3_ARC_FILE_TABLE_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace sh3 { namespace arc {
+
+    /**
+     *  A file in a @ref file_table.
+     *
+     *  The path is not stored in the record itself, but in a string arena shared by all records.
+     */
+    struct file_record final
+    {
+        std::uint32_t name;       /**< Offset of the path in the string arena. */
+        std::uint16_t nameLength; /**< Length of the path. */
+        std::uint16_t index;      /**< The @ref subarc::index_t of the file. */
+    };
+
+    /**
+     *  The files of a @ref subarc, as an array of @ref file_record "file_records" sorted by path.
+     *
+     *  This is only a view: the records and the string arena are owned by the @ref mft
+     *  (or the @ref mft_cache it was loaded from).
+     */
+    class file_table final
+    {
+    public:
+        using const_iterator = const file_record*; /**< Iterator over the records. */
+
+    public:
+        /**
+         *  Constructor. Creates an empty table.
+         */
+        file_table() = default;
+
+        /**
+         *  Constructor.
+         *
+         *  @param arena      The string arena the @ref file_record::name "names" refer to.
+         *  @param records    The records, sorted by path. There may be no duplicate paths.
+         *  @param numRecords Number of @p records.
+         */
+        file_table(const char* arena, const file_record* records, std::size_t numRecords)
+            : arena(arena), records(records), numRecords(numRecords) {}
+
+        /**
+         *  Look up a file.
+         *
+         *  @param name Path of the file.
+         *
+         *  @returns The record of the file, or @c nullptr if it is not in this table.
+         */
+        const file_record* Find(std::string_view name) const;
+
+        /**
+         *  Get the path of a file.
+         *
+         *  @param record A record of this table.
+         *
+         *  @returns A view into the string arena.
+         */
+        std::string_view GetName(const file_record& record) const { return std::string_view(arena + record.name, record.nameLength); }
+
+        std::size_t size() const { return numRecords; }              /**< Get the number of files. */
+        const_iterator begin() const { return records; }              /**< Get an iterator to the first record. */
+        const_iterator end() const { return records + numRecords; }   /**< Get an iterator past the last record. */
+
+    private:
+        const char*        arena = nullptr;   /**< The string arena. */
+        const file_record* records = nullptr; /**< The records. */
+        std::size_t        numRecords = 0;    /**< Number of @ref records. */
+    };
+
+} }
+
+#endif // SH3_ARC_FILE_TABLE_HPP_INCLUDED
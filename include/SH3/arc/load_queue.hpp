@@ -0,0 +1,154 @@
+/** @file
+ *  Background loading of files from @c arc.arc.
+ *
+ *  @see @ref arc-files
+ *
+ *  @copyright 2016-2019 Palm Studios
+ */
+#ifndef SH3_ARC_LOAD_QUEUE_HPP_INCLUDED
+#define SH3_ARC_LOAD_QUEUE_HPP_INCLUDED
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SH3/arc/mft.hpp"
+#include "SH3/common/singleton.hpp"
+
+namespace sh3 { namespace arc {
+
+    /**
+     *  A pool of I/O worker threads that load files through an @ref mft.
+     *
+     *  Requests are served highest @ref priority_t first. Among requests of equal priority the one with
+     *  the earliest deadline goes first, and after that requests are served in the order they were submitted.
+     *  A request that completes after its deadline is still delivered, but a warning is logged.
+     *
+     *  The result of a request is delivered either through a @c std::future, or through a @ref callback that
+     *  is run by @ref Poll on the thread calling it (the game loop in @ref sh3::engine::CEngine::Run), so the
+     *  callback can safely touch OpenGL.
+     */
+    class load_queue final : public CSingleton<load_queue>
+    {
+        friend class CSingleton<load_queue>;
+
+    public:
+        using clock = std::chrono::steady_clock; /**< Clock the deadlines are measured with. */
+        using priority_t = int;                  /**< Priority of a request. Higher values are loaded first. */
+
+        static constexpr priority_t PRIORITY_LOW    = -1; /**< For files that are only needed later on. */
+        static constexpr priority_t PRIORITY_NORMAL =  0; /**< Default priority. */
+        static constexpr priority_t PRIORITY_HIGH   =  1; /**< For files that are needed as soon as possible. */
+
+        static constexpr std::size_t DEFAULT_WORKERS = 2; /**< Number of worker threads. Loading is I/O-bound, so a few are enough. */
+
+        /**
+         *  The outcome of a request.
+         */
+        struct result final
+        {
+            std::string               filename; /**< Path of the file that was requested. */
+            std::vector<std::uint8_t> data;     /**< Contents of the file. */
+            mft::load_error           error;    /**< @ref mft::load_error from loading the file. */
+        };
+
+        /** Function receiving the @ref result of a request. */
+        using callback = std::function<void(result&)>;
+
+    public:
+        /**
+         *  Destructor. Drops all pending requests and waits for the worker threads to finish.
+         */
+        ~load_queue();
+
+        /**
+         *  Queue a file to be loaded.
+         *
+         *  @param source   The @ref mft to load the file from. Must stay alive until the request is done or discarded.
+         *  @param filename Path to the file to load.
+         *  @param priority The @ref priority_t of the request.
+         *  @param deadline When the file is needed by.
+         *  @param owner    Tag for @ref Discard.
+         *
+         *  @returns A future that becomes ready once the file is loaded. It is broken if the request is discarded.
+         */
+        std::future<result> Submit(const mft& source, const std::string& filename, priority_t priority = PRIORITY_NORMAL, clock::time_point deadline = clock::time_point::max(), const void* owner = nullptr);
+
+        /**
+         *  Queue a file to be loaded.
+         *
+         *  @param source   The @ref mft to load the file from. Must stay alive until the request is done or discarded.
+         *  @param filename Path to the file to load.
+         *  @param onLoaded Run by @ref Poll once the file is loaded.
+         *  @param priority The @ref priority_t of the request.
+         *  @param deadline When the file is needed by.
+         *  @param owner    Tag for @ref Discard.
+         */
+        void Submit(const mft& source, const std::string& filename, callback onLoaded, priority_t priority = PRIORITY_NORMAL, clock::time_point deadline = clock::time_point::max(), const void* owner = nullptr);
+
+        /**
+         *  Run the callbacks of all requests that have completed since the last call.
+         *
+         *  This never waits for pending requests.
+         *
+         *  @returns The number of callbacks that were run.
+         */
+        std::size_t Poll();
+
+        /**
+         *  Forget all requests submitted with @p owner.
+         *
+         *  Pending requests are dropped, completed ones are not passed to their callback and requests that are
+         *  being loaded right now are waited for. Afterwards nothing refers to the @ref mft or the callbacks of
+         *  those requests any more.
+         *
+         *  @param owner The tag the requests were submitted with.
+         */
+        void Discard(const void* owner);
+
+    private:
+        struct request;
+
+        /**
+         *  Constructor. Starts the worker threads.
+         *
+         *  @param numWorkers Number of worker threads.
+         */
+        load_queue(std::size_t numWorkers = DEFAULT_WORKERS);
+
+        /**
+         *  Add a request to @ref pending.
+         *
+         *  @param req The request.
+         */
+        void Push(std::unique_ptr<request> req);
+
+        /**
+         *  Body of the worker threads.
+         */
+        void Work();
+
+    private:
+        std::mutex                            lock;       /**< Guards all members below. */
+        std::condition_variable               wake;       /**< Signalled when a request is added or the queue shuts down. */
+        std::condition_variable               finished;   /**< Signalled when a worker finishes a request. */
+        bool                                  stop = false; /**< Whether the workers should exit. */
+        std::uint64_t                         sequence = 0; /**< Submission counter, to keep equal requests in order. */
+        std::vector<std::unique_ptr<request>> pending;    /**< Requests that have not been picked up yet. Kept as a heap. */
+        std::vector<const request*>           active;     /**< Requests currently being loaded. */
+        std::deque<std::unique_ptr<request>>  completed;  /**< Loaded requests waiting for @ref Poll. */
+        std::vector<std::thread>              workers;    /**< The worker threads. */
+    };
+
+} }
+
+#endif // SH3_ARC_LOAD_QUEUE_HPP_INCLUDED
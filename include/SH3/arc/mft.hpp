@@ -10,13 +10,24 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "SH3/arc/file_index.hpp"
+#include "SH3/arc/file_table.hpp"
+#include "SH3/arc/mft_cache.hpp"
 #include "SH3/arc/subarc.hpp"
 #include "SH3/system/assert.hpp"
 
 namespace sh3 { namespace arc {
 
+    /**
+     *  The Master File Table: every file in the sub-arcs, and where to find it.
+     *
+     *  An @ref mft does not change after it is constructed, and the @c const member functions
+     *  (including loading files) can be called from several threads at once.
+     *  The game shares a single instance, see @ref Shared.
+     */
     struct mft final
     {
     public:
@@ -37,14 +48,43 @@ namespace sh3 { namespace arc {
 
             std::string message() const;
 
+            /**
+             *  Get the error of the @ref subarc the file is located in.
+             *
+             *  @returns The @ref subarc::load_error. Only meaningful for @ref load_result::SUBARC_ERROR.
+             */
+            const subarc::load_error& get_subarc_error() const { return subarcError; }
+
         private:
             subarc::load_error subarcError;
         };
 
+        /**
+         *  Where a file loaded by @ref LoadFiles ended up.
+         */
+        struct batch_result final
+        {
+            std::size_t offset = 0; /**< Position of the file in the arena. */
+            std::size_t size = 0;   /**< Number of bytes of the file that were loaded. */
+            load_error  error;      /**< @ref load_error for this file. */
+        };
+
     public:
         std::vector<subarc> subarcs;    /**< List of all the subarcs in @c arc.arc */
 
         mft();
+        mft(const mft&) = delete;
+        mft& operator=(const mft&) = delete;
+
+        /**
+         *  Get the process-wide @ref mft.
+         *
+         *  It is constructed the first time this is called, and lives until the program exits.
+         *  Use this instead of constructing another @ref mft, so @c arc.arc is only read once.
+         *
+         *  @returns The shared @ref mft.
+         */
+        static const mft& Shared();
 
         /**
          *  Load a file from an subarc into @c buffer.
@@ -58,7 +98,7 @@ namespace sh3 { namespace arc {
          *
          *  @returns  The file length if loading is successful, @ref arcFileNotFound if not.
          */
-        std::size_t LoadFile(const std::string& filename, std::vector<std::uint8_t>& buffer, std::vector<std::uint8_t>::iterator& start, load_error &e);
+        std::size_t LoadFile(std::string_view filename, std::vector<std::uint8_t>& buffer, std::vector<std::uint8_t>::iterator& start, load_error &e) const;
 
         /**
          *  Load a file from an subarc into @c buffer.
@@ -72,7 +112,72 @@ namespace sh3 { namespace arc {
          *
          *  @returns The file length if loading is successful, @ref arcFileNotFound if not.
          */
-        std::size_t LoadFile(const std::string& filename, std::vector<std::uint8_t>& buffer, load_error &e) { auto back = end(buffer); return LoadFile(filename, buffer, back, e); }
+        std::size_t LoadFile(std::string_view filename, std::vector<std::uint8_t>& buffer, load_error &e) const { auto back = end(buffer); return LoadFile(filename, buffer, back, e); }
+
+        /**
+         *  Get a read-only view of a file inside its memory-mapped subarc, without copying it.
+         *
+         *  @param filename Path to the file to map.
+         *  @param span     Set to the contents of the file. Valid for as long as this @ref mft.
+         *  @param e        @ref load_error from this operation.
+         *
+         *  @returns The file length if mapping is successful, @c 0 if not.
+         *
+         *  @see @ref subarc::MapFile
+         */
+        std::size_t MapFile(std::string_view filename, file_span& span, load_error &e) const;
+
+        /**
+         *  Find where a file is stored, to read it piece by piece with @ref subarc::ReadFileAt.
+         *
+         *  @param filename Path to the file.
+         *  @param index    Set to the @ref subarc::index_t of the file.
+         *  @param e        @ref load_error from this operation.
+         *
+         *  @returns The @ref subarc the file is in, or @c nullptr if it does not exist.
+         */
+        const subarc* FindFile(std::string_view filename, subarc::index_t& index, load_error &e) const;
+
+        /**
+         *  Load several files at once.
+         *
+         *  The files are grouped by subarc and read in the order they are stored in, see @ref subarc::LoadFiles.
+         *  Prefer this over calling @ref LoadFile for each file when many files are needed at the same time.
+         *
+         *  @param filenames Paths to the files to load.
+         *  @param arena     The buffer the file contents are appended to.
+         *  @param results   Set to one @ref batch_result per entry of @p filenames, in the same order.
+         */
+        void LoadFiles(const std::vector<std::string_view>& filenames, std::vector<std::uint8_t>& arena, std::vector<batch_result>& results) const;
+
+    private:
+        /**
+         *  Fill @ref subarcs and @ref index from @ref cache instead of parsing @c arc.arc.
+         */
+        void LoadCache();
+
+        /**
+         *  Add a subarc to @ref subarcs and its files to @ref index.
+         *
+         *  @param name  Name of the subarc.
+         *  @param files The files of the subarc.
+         */
+        void AddSubarc(std::string&& name, file_table files);
+
+        /**
+         *  Look up a file in @ref index.
+         *
+         *  @param filename Path to the file.
+         *  @param e        Set to @ref load_result::FILE_NOT_FOUND if the file does not exist.
+         *
+         *  @returns The @ref file_index::entry for the file, or @c nullptr if it does not exist.
+         */
+        const file_index::entry* Find(std::string_view filename, load_error &e) const;
+
+        mft_cache                cache;   /**< The index file @ref subarcs were loaded from, if it was up to date. */
+        std::string              arena;   /**< Paths of all files, if @c arc.arc was parsed instead. */
+        std::vector<file_record> records; /**< Records of all files, if @c arc.arc was parsed instead. */
+        file_index               index;   /**< Maps each file in @ref subarcs to its location. */
     };
 
 } }
@@ -0,0 +1,174 @@
+/** @file
+ *  Prebuilt index of @c arc.arc, so it does not have to be decompressed and parsed at every launch.
+ *
+ *  @see @ref arc-files
+ *
+ *  @copyright 2016-2019 Palm Studios
+ */
+#ifndef SH3_ARC_MFT_CACHE_HPP_INCLUDED
+#define SH3_ARC_MFT_CACHE_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "SH3/arc/file_index.hpp"
+#include "SH3/arc/file_table.hpp"
+#include "SH3/arc/subarc.hpp"
+
+namespace sh3 { namespace arc {
+
+    /**
+     *  A read-only, memory-mapped index file holding the contents of @c arc.arc.
+     *
+     *  The file consists of a @ref header, an array of @ref subarc_record "subarc_records", an array of
+     *  @ref file_record "file_records", the slots of a @ref file_index of all files and a string table with all
+     *  the names. The files of each subarc are stored sorted by name, so they can be used as a @ref file_table
+     *  right from the mapping, and the @ref file_index is used right from the mapping as well. So loading the
+     *  cache neither hashes nor copies any file name.
+     *
+     *  The @ref header records the size and CRC-32 of the @c arc.arc it was built from. If they do not match
+     *  the current @c arc.arc, the cache is ignored (and rebuilt by @ref mft).
+     *
+     *  @note The cache is written in native byte order. It is meant to be built on the machine that uses it.
+     */
+    class mft_cache final
+    {
+    public:
+        /**
+         *  Identifies the version of @c arc.arc a cache was built from.
+         */
+        struct digest final
+        {
+            std::uint64_t size = 0; /**< Size of the (compressed) @c arc.arc in bytes. */
+            std::uint32_t crc = 0;  /**< CRC-32 of the (compressed) @c arc.arc. */
+        };
+
+        /**
+         *  A subarc in the cache.
+         */
+        struct subarc_record final
+        {
+            std::uint32_t name;       /**< Offset of the name in the string table. */
+            std::uint32_t nameLength; /**< Length of the name. */
+            std::uint32_t firstFile;  /**< Position of the first @ref file_record of this subarc. */
+            std::uint32_t numFiles;   /**< Number of files in this subarc. */
+        };
+
+    public:
+        /**
+         *  Compute the @ref digest of an @c arc.arc.
+         *
+         *  @param arcPath Path to the @c arc.arc.
+         *  @param d       Set to the @ref digest of the file.
+         *
+         *  @returns @c true on success, @c false if the file could not be read.
+         */
+        static bool ComputeDigest(const std::string& arcPath, digest& d);
+
+        /**
+         *  Write a cache file.
+         *
+         *  The cache is written to a temporary file first, so an interrupted write never leaves a broken cache behind.
+         *  Failing to write the cache is not an error (the data directory might be read-only); a warning is logged.
+         *
+         *  @param path    Path of the cache file.
+         *  @param d       @ref digest of the @c arc.arc the subarcs were read from.
+         *  @param subarcs The subarcs to store.
+         *
+         *  @returns @c true if the cache was written.
+         */
+        static bool Write(const std::string& path, const digest& d, const std::vector<subarc>& subarcs);
+
+        /**
+         *  Map a cache file and check that it is complete and matches @p d.
+         *
+         *  @param path Path of the cache file.
+         *  @param d    @ref digest of the current @c arc.arc.
+         *
+         *  @returns @c true if the cache can be used.
+         */
+        bool Open(const std::string& path, const digest& d);
+
+        /**
+         *  Get the number of subarcs in the cache.
+         */
+        std::size_t GetSubarcCount() const { return numSubarcs; }
+
+        /**
+         *  Get the number of files in the cache.
+         */
+        std::size_t GetFileCount() const { return numFiles; }
+
+        /**
+         *  Get a subarc.
+         *
+         *  @param i Position of the subarc. Must be less than @ref GetSubarcCount.
+         */
+        const subarc_record& GetSubarc(std::size_t i) const;
+
+        /**
+         *  Get the files of a subarc.
+         *
+         *  @param sub A subarc of this cache.
+         *
+         *  @returns A @ref file_table viewing the mapped cache file.
+         */
+        file_table GetFileTable(const subarc_record& sub) const { return file_table(strings, files + sub.firstFile, sub.numFiles); }
+
+        /**
+         *  Get the index of all files.
+         *
+         *  @returns A @ref file_index viewing the mapped cache file. Its @ref file_index::entry::subarc "subarcs" are
+         *           positions of @ref GetSubarc.
+         */
+        file_index GetIndex() const { return file_index(strings, slots, numSlots, numIndexed); }
+
+        /**
+         *  Get a string from the string table.
+         *
+         *  @param offset Offset of the string.
+         *  @param length Length of the string.
+         *
+         *  @returns A view into the mapped cache file.
+         */
+        std::string_view GetString(std::uint32_t offset, std::uint32_t length) const;
+
+    private:
+        /**
+         *  The start of the cache file.
+         */
+        struct header final
+        {
+            std::uint32_t magic;       /**< Always @ref expectedMagic. */
+            std::uint32_t version;     /**< Always @ref expectedVersion. */
+            std::uint64_t arcSize;     /**< @ref digest::size of the @c arc.arc. */
+            std::uint32_t arcCrc;      /**< @ref digest::crc of the @c arc.arc. */
+            std::uint32_t numSubarcs;  /**< Number of @ref subarc_record "subarc_records". */
+            std::uint32_t numFiles;    /**< Number of @ref file_record "file_records". */
+            std::uint32_t stringsSize; /**< Size of the string table in bytes. */
+            std::uint32_t numSlots;    /**< Number of @ref file_index::entry "file_index slots". */
+            std::uint32_t numIndexed;  /**< Number of occupied @ref file_index::entry "file_index slots". */
+
+            static constexpr std::uint32_t expectedMagic = 0x58444933; /**< "3IDX" */
+            static constexpr std::uint32_t expectedVersion = 2;       /**< Bumped whenever the layout changes. */
+        };
+
+        boost::interprocess::mapped_region mapping;    /**< The mapped cache file. */
+        const subarc_record*               subarcs = nullptr; /**< The subarc table in @ref mapping. */
+        const file_record*                 files = nullptr;   /**< The file table in @ref mapping. */
+        const file_index::entry*           slots = nullptr;   /**< The slots of the file index in @ref mapping. */
+        const char*                        strings = nullptr; /**< The string table in @ref mapping. */
+        std::size_t                        numSubarcs = 0;    /**< Number of entries in @ref subarcs. */
+        std::size_t                        numFiles = 0;      /**< Number of entries in @ref files. */
+        std::size_t                        numSlots = 0;      /**< Number of entries in @ref slots. */
+        std::size_t                        numIndexed = 0;    /**< Number of occupied entries in @ref slots. */
+    };
+
+} }
+
+#endif // SH3_ARC_MFT_CACHE_HPP_INCLUDED
@@ -15,26 +15,41 @@
 #include <cstdint>
 #include <ios>
 #include <iterator>
-#include <map>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "SH3/arc/file_table.hpp"
 #include "SH3/error.hpp"
 
 namespace sh3 { namespace arc {
     static constexpr int arcFileNotFound = -1; /**< Status @ref mft::LoadFile() and @ref subarc::LoadFile() return if a file cannot be found. */
 
+    /**
+     *  Read-only view of the contents of a file inside a memory-mapped subarc-file.
+     *
+     *  The view stays valid for as long as the @ref subarc it was obtained from.
+     */
+    struct file_span final
+    {
+        const std::uint8_t* data = nullptr; /**< First byte of the file. */
+        std::size_t         size = 0;       /**< Length of the file in bytes. */
+    };
+
     /**
      *  An sub-arc.
+     *
+     *  Files can be loaded from several threads at once.
      */
     class subarc final
     {
     public:
         /** Index to retrieve a file. */
         using index_t = std::uint16_t;
-        /** A mapping of filenames to the file's @ref index_t. */
-        using files_map = std::map<std::string, index_t>;
+        static_assert(std::is_same<index_t, decltype(file_record::index)>::value, "file_record must be able to hold an index_t");
 
         /**
          *  An enum representing possible results from trying to load a file.
@@ -48,6 +63,7 @@ namespace sh3 { namespace arc {
             //TODO: END_OF_FILE?
             PARTIAL_READ,        ///< End of file reached before completing the load.
             PARTIAL_HEADER_READ, ///< End of file reached before even loading the file.
+            MAP_ERROR,           ///< The subarc-file could not be mapped into memory.
         };
         struct load_error final : public error<load_result>
         {
@@ -97,6 +113,11 @@ namespace sh3 { namespace arc {
              */
             void set_partial_header_read_error(header headerType, std::size_t numRead) { result = load_result::PARTIAL_HEADER_READ; headerReadError = {headerType, numRead}; }
 
+            /**
+             *  Set the wrapped @ref load_result to @ref load_result::MAP_ERROR.
+             */
+            void set_map_error() { result = load_result::MAP_ERROR; }
+
             /**
              *  Stringify the @ref load_error.
              *  
@@ -130,13 +151,14 @@ namespace sh3 { namespace arc {
         };
 
     public:
-        subarc(subarc&&) = default;
+        subarc(subarc&&);
         /** Constructor.
          *  
          *  @param subarcName The name of this @ref subarc.
-         *  @param filesMap   The @ref files_map for this @ref subarc.
+         *  @param fileTable  The @ref file_table for this @ref subarc.
          */
-        subarc(std::string &&subarcName, files_map &&filesMap): name(std::move(subarcName)), files(std::move(filesMap)) { }
+        subarc(std::string &&subarcName, file_table fileTable);
+        ~subarc();
 
         /**
          *  Load a file into @c buffer.
@@ -150,7 +172,7 @@ namespace sh3 { namespace arc {
          *  
          *  @returns The file length if loading is successful, @ref arcFileNotFound if not.
          */
-        std::size_t LoadFile(const std::string& filename, std::vector<std::uint8_t>& buffer, std::vector<std::uint8_t>::iterator& start, load_error &e);
+        std::size_t LoadFile(std::string_view filename, std::vector<std::uint8_t>& buffer, std::vector<std::uint8_t>::iterator& start, load_error &e) const;
 
         /**
          *  Load a file into @c buffer.
@@ -163,7 +185,7 @@ namespace sh3 { namespace arc {
          *  
          *  @returns The file length if loading is successful, @ref arcFileNotFound if not.
          */
-        std::size_t LoadFile(const std::string& filename, std::vector<std::uint8_t>& buffer, load_error &e) { auto back = end(buffer); return LoadFile(filename, buffer, back, e); }
+        std::size_t LoadFile(std::string_view filename, std::vector<std::uint8_t>& buffer, load_error &e) const { auto back = end(buffer); return LoadFile(filename, buffer, back, e); }
 
         /**
          *  Load a file into @c buffer.
@@ -177,7 +199,7 @@ namespace sh3 { namespace arc {
          *  
          *  @returns The file length if loading is successful, @ref arcFileNotFound if not.
          */
-        std::size_t LoadFile(index_t index, std::vector<std::uint8_t>& buffer, std::vector<std::uint8_t>::iterator& start, load_error &e);
+        std::size_t LoadFile(index_t index, std::vector<std::uint8_t>& buffer, std::vector<std::uint8_t>::iterator& start, load_error &e) const;
 
         /**
          *  Load a file into @c buffer.
@@ -190,23 +212,113 @@ namespace sh3 { namespace arc {
          *  
          *  @returns The file length if loading is successful, @ref arcFileNotFound if not.
          */
-        std::size_t LoadFile(index_t index, std::vector<std::uint8_t>& buffer, load_error &e) { auto back = end(buffer); return LoadFile(index, buffer, back, e); }
+        std::size_t LoadFile(index_t index, std::vector<std::uint8_t>& buffer, load_error &e) const { auto back = end(buffer); return LoadFile(index, buffer, back, e); }
+
+        /**
+         *  Get a view of a file without copying it.
+         *
+         *  The whole subarc-file is mapped into memory (read-only) the first time this is called,
+         *  so the operating system's page cache is shared with any other process reading the same subarc.
+         *
+         *  @param index  The @ref index_t for the file to map.
+         *  @param span   Set to the contents of the file.
+         *  @param e      @ref load_error from this operation. Set to @ref load_result::MAP_ERROR if mapping is not possible,
+         *                in which case @ref LoadFile can still be used.
+         *
+         *  @returns The file length if mapping is successful, @c 0 if not.
+         */
+        std::size_t MapFile(index_t index, file_span& span, load_error &e) const;
+
+        /**
+         *  Get the size of a file.
+         *
+         *  @param index The @ref index_t of the file.
+         *  @param e     @ref load_error from this operation.
+         *
+         *  @returns The length of the file in bytes, @c 0 on error.
+         */
+        std::size_t GetFileSize(index_t index, load_error &e) const;
+
+        /**
+         *  Read part of a file, without loading the rest of it.
+         *
+         *  @param index       The @ref index_t of the file.
+         *  @param offset      Position in the file to start reading at.
+         *  @param destination Where to store the data.
+         *  @param len         Number of bytes to read. The read stops early at the end of the file.
+         *  @param e           @ref load_error from this operation.
+         *
+         *  @returns The number of bytes read.
+         */
+        std::size_t ReadFileAt(index_t index, std::size_t offset, void* destination, std::size_t len, load_error &e) const;
+
+        /**
+         *  A file requested from @ref LoadFiles, and where it ended up.
+         */
+        struct batch_item final
+        {
+            index_t     index;      /**< The @ref index_t of the file to load. */
+            std::size_t offset = 0; /**< Set to the position of the file in the arena. */
+            std::size_t size = 0;   /**< Set to the number of bytes of the file that were loaded. */
+            load_error  error;      /**< Set to the @ref load_error for this file. */
+        };
+
+        /**
+         *  Load several files at once.
+         *
+         *  The files are read in the order they are stored in the subarc-file. Files that lie close together
+         *  are read with a single read, so loading many small files turns into a few sequential reads.
+         *  The data is appended to @p arena; the bytes between files read together end up in the arena too.
+         *
+         *  @param items The files to load. The results are filled in.
+         *  @param arena The buffer the file contents are appended to.
+         */
+        void LoadFiles(std::vector<batch_item>& items, std::vector<std::uint8_t>& arena) const;
+
+        /**
+         *  Get the files in this subarc.
+         *
+         *  @returns The @ref file_table of this subarc.
+         */
+        const file_table& GetFiles() const { return files; }
 
     public:
         const std::string name; /**< Name of this subarc. */
 
     private:
+        /**
+         *  The subarc-file once it has been opened, along with its file table.
+         */
+        struct open_file;
+
         /** Open the subarc-file.
          *  
          *  @param mode The @c openmode for the file.
          *  
          *  @returns The subarc-file stream.
          */
-        std::ifstream open(std::ios_base::openmode mode = std::ios::binary);
+        std::ifstream open(std::ios_base::openmode mode = std::ios::binary) const;
+
+        /**
+         *  Make sure @ref file is open and its file table is loaded.
+         *
+         *  The first call opens the subarc-file, checks its header and reads the file table.
+         *  Later calls just report the outcome of the first one.
+         *
+         *  @note @ref open_file::lock must be held.
+         *
+         *  @param e @ref load_error from this operation.
+         *
+         *  @returns @c true if the subarc-file is usable, @c false if not.
+         */
+        bool EnsureOpen(load_error &e) const;
 
 
         /** Maps a file (and its associated virtual path) to its subarc index. */
-        files_map files;
+        file_table files;
+
+        /** The subarc-file, which is kept open between loads. */
+        std::unique_ptr<open_file> file;
     };
 
 } }
@@ -15,6 +15,7 @@
 #include <ios>
 #include <string>
 #include <vector>
+#include "SH3/arc/subarc.hpp"
 #include "SH3/error.hpp"
 
 namespace sh3 { namespace arc {
@@ -29,6 +30,10 @@ namespace sh3 { namespace arc {
      *  Each read sets the @ref read_error indicating whether a partial read was performed,
      *  or that the end of file was encountered (meaning that @ref fpos `+ len` was equal to @ref fsize.
      *
+     *  Whenever possible the file is read straight from the memory-mapped subarc (see @ref mft::MapFile),
+     *  so opening it does not copy anything. Otherwise it is streamed: @ref buffer only holds a window of the file
+     *  around the part that was last read, and is refilled from the subarc-file (see @ref subarc::ReadFileAt)
+     *  when a read leaves it. Either way, the @ref mft it was opened from must outlive the @ref vfile.
      */
     struct vfile final
     {
@@ -51,9 +56,22 @@ namespace sh3 { namespace arc {
 
 
         vfile(){}
-        vfile(mft& mft, const std::string& filename): fpos(0), fname(filename)
+        vfile(const mft& mft, const std::string& filename): fpos(0), fname(filename)
         {Open(mft, filename);}
 
+        /**
+         *  Open a file that has already been loaded (for example by @ref load_queue).
+         *
+         *  @param data     The contents of the file.
+         *  @param filename The name of the file.
+         */
+        vfile(std::vector<std::uint8_t>&& data, const std::string& filename);
+
+        vfile(const vfile&) = delete;
+        vfile(vfile&&) = default;
+        vfile& operator=(const vfile&) = delete;
+        vfile& operator=(vfile&&) = default;
+
         /**
          *  Read @c len bytes of data into a destination buffer.
          *
@@ -65,6 +83,19 @@ namespace sh3 { namespace arc {
          */
         std::size_t ReadData(void* destination, std::size_t len, read_error& e);
 
+        /**
+         *  Read @c len bytes of data without copying them.
+         *
+         *  Behaves like @ref ReadData, but returns a view of the data instead.
+         *
+         *  @param len         Number of bytes to read from the file.
+         *  @param e           @ref read_error from this operation.
+         *
+         *  @returns The bytes read (which should be @c len bytes long). If the file is streamed, they are valid until
+         *           the next read. Otherwise they are valid for as long as this file is open.
+         */
+        file_span ReadSpan(std::size_t len, read_error& e);
+
         /**
          *  Rewind this file to the beginning (set fpos to 0).
          */
@@ -73,13 +104,13 @@ namespace sh3 { namespace arc {
         /**
          *  Seek to a certain position in the file.
          *
-         *  @param pos    Position to seek to.
-         *  @param origin The origin we want to seek from.
+         *  @param pos    Position to seek to, relative to @p origin.
+         *  @param origin The origin we want to seek from (@c beg, @c cur or @c end).
          */
          void Seek(long pos, std::ios_base::seekdir origin);
 
          /**
-          *  Dump the contents of the vector @ref buffer to a file on disk.
+          *  Dump the contents of this file to a file on disk.
           */
           void Dump2Disk() const;
 
@@ -98,16 +129,45 @@ namespace sh3 { namespace arc {
          *
          *  @returns @c true if the file was found, @c false if not.
          */
-        bool Open(mft& mft, const std::string& filename);
+        bool Open(const mft& mft, const std::string& filename);
 
 
     private:
-        std::size_t fpos;         /**< Current file position */
-        std::size_t fsize;        /**< Size of this file inside the arc section in bytes */
+        /**
+         *  Clamp a read of @c len bytes to the end of the file and advance @ref fpos past it.
+         *
+         *  @param len Number of bytes to read.
+         *  @param e   @ref read_error from this operation.
+         *
+         *  @returns Number of bytes that can be read.
+         */
+        std::size_t Advance(std::size_t len, read_error& e);
+
+        /**
+         *  Get access to a part of the file.
+         *
+         *  If the file is streamed, @ref buffer is refilled unless it already holds the requested part.
+         *
+         *  @param start Position of the first byte.
+         *  @param len   Number of bytes needed. Reduced if the file could not be read that far.
+         *  @param e     Set to @ref load_result::PARTIAL_READ if @p len had to be reduced.
+         *
+         *  @returns Pointer to the byte at @p start.
+         */
+        const std::uint8_t* Access(std::size_t start, std::size_t& len, read_error& e);
+
+        static constexpr std::size_t windowSize = 64 * 1024; /**< Size of the window of a streamed file. */
+
+        std::size_t fpos = 0;     /**< Current file position */
+        std::size_t fsize = 0;    /**< Size of this file inside the arc section in bytes */
         std::string fname;        /**< The name of this file (taken from arc.arc) */
         bool        open = false; /**< Is this file handle currently open? */
 
-        std::vector<std::uint8_t> buffer; /**< Buffer that @ref ReadData() reads from */
+        file_span                 contents;        /**< The data that @ref ReadData() reads from, unless the file is streamed. Points either into the mapped subarc or into @ref buffer */
+        std::vector<std::uint8_t> buffer;          /**< Holds the file if it was already loaded, or the window of a streamed file */
+        const subarc*             source = nullptr; /**< The subarc a streamed file is read from, @c nullptr if the file is not streamed */
+        subarc::index_t           index = 0;       /**< The @ref subarc::index_t of a streamed file */
+        std::size_t               windowStart = 0; /**< Position in the file of the first byte of the window */
     };
 
 } }
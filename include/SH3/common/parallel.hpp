@@ -0,0 +1,54 @@
+/** @file
+ *  Helpers to spread work over all hardware threads.
+ *
+ *  @copyright 2016-2019 Palm Studios
+ */
+#ifndef SH3_PARALLEL_HPP_INCLUDED
+#define SH3_PARALLEL_HPP_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace sh3
+{
+
+/**
+ *  Run @p body for each number in <tt>[0, count)</tt>, spread over all hardware threads.
+ *
+ *  The calling thread does its share of the work, and the function returns once all iterations are done.
+ *
+ *  @param count Number of iterations.
+ *  @param body  Called with each iteration number. Must be safe to call from several threads at once.
+ */
+template<typename Function>
+void ParallelFor(std::size_t count, Function&& body)
+{
+    const std::size_t numThreads = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), count);
+    std::atomic<std::size_t> next{0};
+    const auto work = [&]
+    {
+        for(std::size_t i = next++; i < count; i = next++)
+        {
+            body(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+    for(std::size_t i = 1; i < numThreads; ++i)
+    {
+        threads.emplace_back(work);
+    }
+    work();
+    for(std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+}
+
+#endif // SH3_PARALLEL_HPP_INCLUDED
@@ -17,6 +17,7 @@
 #define _GAMESTATE_HPP_
 
 #include "SH3/engine/statemanager.hpp"
+#include "SH3/arc/load_queue.hpp"
 #include "SH3/arc/mft.hpp"
 
 #include <string>
@@ -49,19 +50,21 @@ public:
      * it is <i>impossible</i> for this state to transition to another!
      */
     CGameState(CStateManager& mgr)
-    : name(""), id(0), stateManager(mgr)
+    : name(""), id(0), stateManager(mgr), mft(sh3::arc::mft::Shared())
     {
 
     }
 
     CGameState(const CGameState& rhs)
-        : name(rhs.name), id(rhs.id), stateManager(rhs.stateManager)
+        : name(rhs.name), id(rhs.id), stateManager(rhs.stateManager), mft(rhs.mft)
         {}
 
     /**
      *  Virtual Destructor
+     *
+     *  Drops any background loads this state still has queued, so none of them outlive it.
      */
-    virtual ~CGameState(){}
+    virtual ~CGameState(){sh3::arc::load_queue::Instance().Discard(this);}
 
     /**
      * State intiailisation function. When the state manager makes a call to
@@ -103,11 +106,29 @@ public:
 
     virtual std::unique_ptr<CGameState> clone() const = 0;
 
+protected:
+    /**
+     * Load a file from @ref mft in the background.
+     *
+     * @param filename  Path to the file to load.
+     * @param onLoaded  Called with the loaded file from the game loop (so it is safe to use OpenGL in it).
+     * @param priority  Priority of this load, see @ref sh3::arc::load_queue::priority_t.
+     * @param deadline  When the file is needed by.
+     *
+     * @note The load is dropped if this state is destroyed first.
+     */
+    void LoadAsync(const std::string& filename, sh3::arc::load_queue::callback onLoaded,
+                   sh3::arc::load_queue::priority_t priority = sh3::arc::load_queue::PRIORITY_NORMAL,
+                   sh3::arc::load_queue::clock::time_point deadline = sh3::arc::load_queue::clock::time_point::max())
+    {
+        sh3::arc::load_queue::Instance().Submit(mft, filename, std::move(onLoaded), priority, deadline, this);
+    }
+
 protected:
     std::string     name;               /**< The name of this state */
     std::uint64_t   id;                 /**< Numerical ID for this state */
     CStateManager&  stateManager;       /**< Reference to @ref sh3::engine::CEngine::stateManager */
-    sh3::arc::mft   mft;
+    const sh3::arc::mft& mft;           /**< The shared Master File Table, see @ref sh3::arc::mft::Shared */
 };
 
 }}
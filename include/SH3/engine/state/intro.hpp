@@ -72,10 +72,7 @@ private:
     using Quad = sh3::gl::CVertexArray;
 
     Quad quadVao2;
-    sh3::gl::CVertexBuffer      vertBuff;
-    sh3::gl::VertexAttribute    vertAttribs;
-    sh3::gl::CVertexBuffer      uvBuff;
-    sh3::gl::VertexAttribute    uvAttribs;
+    sh3::gl::CVertexBuffer      quadBuff;   /**< Interleaved positions and UVs of the quad */
 };
 
 
@@ -0,0 +1,143 @@
+/** @file
+ *
+ *  Texture atlas, to draw many small textures (UI, HUD) from a single OpenGL texture.
+ *
+ *  @copyright 2016-2019  Palm Studios
+ */
+#ifndef SH3_ATLAS_HPP_INCLUDED
+#define SH3_ATLAS_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+namespace sh3 { namespace arc {
+    struct mft;
+} }
+
+namespace sh3 { namespace graphics {
+
+struct texture_image;
+
+/**
+ *  Packs textures into one RGBA texture.
+ *
+ *  Textures are added with @ref Add, which hands back a @ref handle. Once all textures are added, @ref Build packs
+ *  them (in rows, tallest first) and uploads the atlas. After that, @ref GetRegion gives the UV rectangle of each
+ *  texture, so sprites using any of them can be drawn with the atlas bound once.
+ *
+ *  Each texture gets a 1 pixel border copied from its edges, so linear filtering doesn't bleed into its neighbours.
+ */
+class CTextureAtlas final
+{
+public:
+    using handle = std::size_t; /**< Identifies a texture in the atlas. */
+
+    /**
+     *  UV rectangle of a texture in the atlas.
+     */
+    struct region final
+    {
+        GLfloat u0 = 0.0f; /**< Left edge. */
+        GLfloat v0 = 0.0f; /**< Top edge. */
+        GLfloat u1 = 0.0f; /**< Right edge. */
+        GLfloat v1 = 0.0f; /**< Bottom edge. */
+    };
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param _width  Width of the atlas.
+     *  @param _height Height of the atlas.
+     */
+    CTextureAtlas(GLsizei _width, GLsizei _height) : width(_width), height(_height){}
+
+    /**
+     *  Destructor
+     *
+     *  Deletes the atlas texture.
+     */
+    ~CTextureAtlas();
+
+    CTextureAtlas(const CTextureAtlas&) = delete;
+    CTextureAtlas& operator=(const CTextureAtlas&) = delete;
+
+    /**
+     *  Add a texture from one of the @c .arc sections.
+     *
+     *  @param mft      Master File Table (for vfile access)
+     *  @param filename Full path of the texture.
+     *
+     *  @returns The @ref handle of the texture. A broken texture gets an empty region.
+     */
+    handle Add(const sh3::arc::mft& mft, const std::string& filename);
+
+    /**
+     *  Add all textures of a batch from one of the @c .arc sections.
+     *
+     *  @param mft      Master File Table (for vfile access)
+     *  @param filename Full path of the texture file.
+     *
+     *  @returns The @ref handle "handles" of the textures, in the order they are stored in. A broken texture gets
+     *           an empty region; if the file can't be read at all, no handles are returned.
+     */
+    std::vector<handle> AddBatch(const sh3::arc::mft& mft, const std::string& filename);
+
+    /**
+     *  Add a decoded texture.
+     *
+     *  @param image The texture. Only level 0 is used.
+     *
+     *  @returns The @ref handle of the texture.
+     */
+    handle Add(const texture_image& image);
+
+    /**
+     *  Pack all textures and upload the atlas.
+     *
+     *  The textures added so far are packed anew, so more textures can be added and the atlas rebuilt.
+     *
+     *  @returns @c true on success, @c false if the textures don't fit (the atlas is left as it was).
+     */
+    bool Build();
+
+    /**
+     *  Get the UV rectangle of a texture. Only valid after @ref Build.
+     *
+     *  @param h The @ref handle of the texture.
+     */
+    const region& GetRegion(handle h) const;
+
+    /**
+     *  Bind the atlas for use with any draw calls.
+     *
+     *  @param textureUnit The texture unit we want to bind the atlas to
+     */
+    void Bind(GLenum textureUnit) const;
+
+private:
+    /**
+     *  A texture waiting to be packed.
+     */
+    struct entry final
+    {
+        std::uint16_t             width = 0;  /**< Width of the texture. */
+        std::uint16_t             height = 0; /**< Height of the texture. */
+        std::vector<std::uint8_t> pixels;     /**< The texture as RGBA8. */
+        region                    uv;         /**< Where the texture ended up. */
+    };
+
+    GLsizei             width;      /**< Width of the atlas. */
+    GLsizei             height;     /**< Height of the atlas. */
+    std::vector<entry>  entries;    /**< All textures, by @ref handle. */
+    GLuint              tex = 0;    /**< The atlas texture. 0 until @ref Build has succeeded. */
+};
+
+}}
+
+#endif // SH3_ATLAS_HPP_INCLUDED
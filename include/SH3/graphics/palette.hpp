@@ -0,0 +1,64 @@
+/** @file
+ *
+ *  Functions to turn the palette and indices of an 8-bit (paletted) texture into pixels.
+ *
+ *  @copyright 2016-2019  Palm Studios
+ */
+#ifndef SH3_PALETTE_HPP_INCLUDED
+#define SH3_PALETTE_HPP_INCLUDED
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SH3/types/color.hpp"
+
+namespace sh3 { namespace graphics {
+
+/**
+ *  A palette ready to be indexed by the indices of a texture.
+ *
+ *  It always has 256 entries, so any index can be looked up without a range check.
+ */
+using expanded_palette = std::array<rgba, 256>;
+
+/**
+ *  Layout of the pixels written by @ref ExpandPalette.
+ */
+enum class pixel_layout
+{
+    RGB8,  /**< 3 bytes per pixel, alpha is dropped. */
+    RGBA8, /**< 4 bytes per pixel. */
+};
+
+/**
+ *  Build an @ref expanded_palette from the colors stored in a texture.
+ *
+ *  The colors are stored with every other group of 8 colors swapped around (starting from the 8th), so they
+ *  are put back in order here, once per texture, instead of being fixed up in place.
+ *  The alpha of the palette is converted from the PS2 range (where 0x80 is opaque) to 0-255.
+ *
+ *  @param colors The colors as stored in the file.
+ *
+ *  @returns The palette. Entries past the end of @p colors are black.
+ */
+expanded_palette BuildPalette(const std::vector<rgba>& colors);
+
+/**
+ *  Look up the color of every index of a texture.
+ *
+ *  This uses AVX2 gathers if the CPU supports them.
+ *
+ *  @param src       The indices.
+ *  @param srcSize   Number of indices at @p src. Missing indices are treated as 0.
+ *  @param palette   The palette to look the indices up in.
+ *  @param dst       The pixels. Must have room for @p numPixels pixels in @p layout.
+ *  @param numPixels Number of pixels to write.
+ *  @param layout    Layout of the pixels.
+ */
+void ExpandPalette(const std::uint8_t* src, std::size_t srcSize, const expanded_palette& palette, std::uint8_t* dst, std::size_t numPixels, pixel_layout layout);
+
+}}
+
+#endif // SH3_PALETTE_HPP_INCLUDED
@@ -0,0 +1,51 @@
+/** @file
+ *
+ *  Functions to undo the PS2 pixel swizzling of 8-bit (paletted) textures.
+ *
+ *  @copyright 2016-2019  Palm Studios
+ *
+ *  @note The layout was worked out by trial and error and is not fully understood. It is expressed as a table
+ *        from the position of an index in the file to its position in the image, so it only has to be
+ *        worked out once per texture size, rather than for every pixel of every texture.
+ */
+#ifndef SH3_SWIZZLE_HPP_INCLUDED
+#define SH3_SWIZZLE_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sh3 { namespace graphics {
+
+/**
+ *  Maps the n-th index stored in a swizzled texture to its position in the image.
+ */
+using unswizzle_table = std::vector<std::uint32_t>;
+
+/**
+ *  Get the @ref unswizzle_table for a texture size.
+ *
+ *  Tables are built on first use and kept for later textures of the same size. This is thread-safe.
+ *
+ *  @param width  Width of the texture. Should be a multiple of 16.
+ *  @param height Height of the texture. Should be a multiple of 4.
+ *
+ *  @returns The table. Its size is the number of indices stored in the file.
+ */
+std::shared_ptr<const unswizzle_table> GetUnswizzleTable(std::uint16_t width, std::uint16_t height);
+
+/**
+ *  Unswizzle the indices of an 8-bit texture.
+ *
+ *  @param src     The indices as stored in the file.
+ *  @param srcSize Number of bytes at @p src. Missing indices are treated as 0.
+ *  @param dst     The image. Pixels the table does not cover are left alone.
+ *  @param dstSize Number of bytes at @p dst.
+ *  @param table   The @ref unswizzle_table for the size of the texture.
+ */
+void Unswizzle8(const std::uint8_t* src, std::size_t srcSize, std::uint8_t* dst, std::size_t dstSize, const unswizzle_table& table);
+
+}}
+
+#endif // SH3_SWIZZLE_HPP_INCLUDED
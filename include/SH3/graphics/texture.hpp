@@ -10,6 +10,9 @@
  *
  *  @note It would seem the 8-bit texture palette comes at the END of the texture, not at beginning like one would expect.
  *  @note bpp == 32, RGBA; bpp == 24, BGR; bpp == 16, RGBA16; bpp=8, Paletted.
+ *  @note Textures use immutable storage with a full mip chain (except paletted textures, which have no mip levels).
+ *  @note Paletted textures are kept paletted on the GPU: the indices are a @c GL_R8UI texture and the palette is
+ *        a 256x1 texture, which the @c image shader looks the color up in.
  *
  *  @date 2-1-2017
  *
@@ -20,6 +23,8 @@
 
 #include "SH3/arc/vfile.hpp"
 
+#include <vector>
+
 #include <GL/glew.h>
 #include <GL/gl.h>
 
@@ -106,6 +111,57 @@ struct palette_info
 
 namespace sh3 { namespace graphics {
 
+struct texture_image;
+
+/**
+ *  Decode a texture from an @c .arc section.
+ *
+ *  Only the first texture of a batch is decoded; see @ref DecodeTextureBatch for the others.
+ *
+ *  @param file  The texture file.
+ *  @param image Set to the decoded texture. Its level 0 might point into @p file.
+ *
+ *  @returns @c true on success, @c false if the texture is broken.
+ */
+bool DecodeTexture(sh3::arc::vfile& file, texture_image& image);
+
+/**
+ *  Decode all textures of a batch (a texture file with more than one texture, such as the skins of a model).
+ *
+ *  The file is read once, and the textures are decoded in parallel.
+ *
+ *  @param file   The texture file.
+ *  @param images Set to the decoded textures, in the order they are stored in. A broken texture has no levels.
+ *                Level 0 of each texture might point into @p file.
+ *
+ *  @returns @c true on success, @c false if the file doesn't hold any textures.
+ */
+bool DecodeTextureBatch(sh3::arc::vfile& file, std::vector<texture_image>& images);
+
+/**
+ *  Get a decoded texture from the texture cache, or decode it (and add it to the cache).
+ *
+ *  @param mft      Master File Table (for vfile access)
+ *  @param filename Full path of the texture in one of the @c .arc sections
+ *  @param image    Set to the decoded texture. It holds its own pixels.
+ *
+ *  @returns @c true on success, @c false if the texture is broken.
+ */
+bool LoadTextureImage(const sh3::arc::mft& mft, const std::string& filename, texture_image& image);
+
+/**
+ *  Get a decoded texture from the texture cache, or decode it (and add it to the cache), for a file that has
+ *  already been loaded, e.g. by the @ref sh3::arc::load_queue.
+ *
+ *  @param mft      Master File Table the file was loaded from (to find its cache key)
+ *  @param filename Full path of the texture in one of the @c .arc sections
+ *  @param file     The texture file.
+ *  @param image    Set to the decoded texture. It holds its own pixels.
+ *
+ *  @returns @c true on success, @c false if the texture is broken.
+ */
+bool LoadTextureImage(const sh3::arc::mft& mft, const std::string& filename, sh3::arc::vfile& file, texture_image& image);
+
 /**
  *
  * Describes a logical texture that can be bound to OpenGL
@@ -126,6 +182,18 @@ public:
         PALETTE = 8,
     };
 
+    /**
+     *  Filtering and wrapping of a texture.
+     */
+    struct sampler_state final
+    {
+        GLint   minFilter = GL_LINEAR_MIPMAP_LINEAR;    /**< Minification filter */
+        GLint   magFilter = GL_LINEAR;                  /**< Magnification filter */
+        GLint   wrapS = GL_REPEAT;                      /**< Wrapping along s */
+        GLint   wrapT = GL_REPEAT;                      /**< Wrapping along t */
+        GLfloat anisotropy = 1.0f;                      /**< Maximum anisotropy. 1 turns anisotropic filtering off; clamped to what the GL supports */
+    };
+
     /**
      * Constructor
      */
@@ -139,7 +207,7 @@ public:
      * @param mft       Master File Table (for vfile access)
      * @param filename  Full path of the file we want to load from one of the @c .arc sections
      */
-    CTexture(sh3::arc::mft& mft, const std::string& filename){Load(mft, filename);}
+    CTexture(const sh3::arc::mft& mft, const std::string& filename){Load(mft, filename);}
 
     /**
      * Constructor
@@ -150,18 +218,68 @@ public:
      */
     CTexture(const std::string& path){Load(path);}
 
+    /**
+     * Copy constructor
+     *
+     * @warning A texture cannot be copied, as it owns its OpenGL texture.
+     */
+    CTexture(const CTexture&) = delete;
+
+    /**
+     * Move constructor
+     *
+     * Takes over the OpenGL texture of @p rhs, which is left empty.
+     */
+    CTexture(CTexture&& rhs) noexcept;
+
     /**
      * Destructor
+     *
+     * Deletes the OpenGL texture(s).
      */
-    ~CTexture(){}
+    ~CTexture(){Unload();}
+
+    CTexture& operator=(const CTexture&) = delete;
+
+    /**
+     * Move assignment operator
+     *
+     * Deletes the OpenGL texture of this texture, then takes over the one of @p rhs, which is left empty.
+     */
+    CTexture& operator=(CTexture&& rhs) noexcept;
 
     /**
      *  Loads a texture from a Virtual File and creates a logical texture
      *  on the gpu
      *
+     *  The decoded texture (with its mip levels) is kept in the texture cache, so later loads of the same
+     *  texture skip the decoding.
+     *
      *  @note Should we scale this ala SILENT HILL 3's "Interal Render Resolution"???
      */
-    void Load(sh3::arc::mft& mft, const std::string& filename);
+    void Load(const sh3::arc::mft& mft, const std::string& filename);
+
+    /**
+     *  Loads a texture from an opened Virtual File and creates a logical texture
+     *  on the gpu
+     *
+     *  The file isn't associated with an @c .arc section, so the texture cache is not used.
+     *
+     *  @param file The texture file.
+     */
+    void Load(sh3::arc::vfile& file);
+
+    /**
+     *  Loads a texture from a Virtual File that was read from @p mft already (e.g. by the
+     *  @ref sh3::arc::load_queue), and creates a logical texture on the gpu
+     *
+     *  Like @ref Load(const sh3::arc::mft&, const std::string&), this goes through the texture cache.
+     *
+     *  @param mft      Master File Table the file was loaded from.
+     *  @param filename Full path of the texture in one of the @c .arc sections
+     *  @param file     The texture file.
+     */
+    void Load(const sh3::arc::mft& mft, const std::string& filename, sh3::arc::vfile& file);
 
     /**
      * Load a physical image from the disk and create an OpenGL texture by
@@ -174,10 +292,33 @@ public:
     /**
      *  Bind this texture for use with any draw calls
      *
+     *  Paletted textures are bound to the two units after @p textureUnit instead (the indices to @p textureUnit + 1,
+     *  the palette to @p textureUnit + 2), as a shader can't sample them with the same sampler as other textures.
+     *
      *  @param textureUnit The texture unit we want to bind this texture to
      */
     void Bind(GLenum textureUnit);
 
+    /**
+     *  Set the filtering and wrapping of this texture.
+     *
+     *  This can be called before the texture is loaded. Paletted textures are always sampled with @c GL_NEAREST,
+     *  as integer textures can't be filtered.
+     *
+     *  @param state The new state.
+     */
+    void SetSampler(const sampler_state& state);
+
+    /**
+     *  Get the filtering and wrapping of this texture.
+     */
+    const sampler_state& GetSampler() const {return sampler;}
+
+    /**
+     *  Check whether this texture is paletted, i.e. has to be drawn with the palette lookup of the @c image shader.
+     */
+    bool IsPaletted() const {return palette != 0;}
+
     /**
      * Get the width of this texture
      */
@@ -193,11 +334,37 @@ public:
       */
     void Unbind();
 
+    /**
+     *  Delete the OpenGL texture(s), freeing the video memory. The texture can be loaded again afterwards.
+     */
+    void Unload() noexcept;
+
+    /**
+     *  Check whether this texture has been loaded.
+     */
+    bool IsLoaded() const {return tex != 0;}
+
+    /**
+     *  Get the (approximate) amount of video memory used by this texture, in bytes.
+     */
+    std::size_t GetMemoryUsage() const {return memoryUsage;}
+
+private:
+    /**
+     *  Create the OpenGL texture(s) for a decoded texture.
+     *
+     *  @param image The decoded texture.
+     */
+    void Upload(const texture_image& image);
+
 private:
-    GLsizei         width;  /**< Texture width */
-    GLsizei         height; /**< Texture height */
-    std::uint8_t    bpp;    /**< Bytes per pixel */
-    GLuint          tex;    /**< ID representing this texture */
+    GLsizei         width = 0;  /**< Texture width */
+    GLsizei         height = 0; /**< Texture height */
+    std::uint8_t    bpp = 0;    /**< Bytes per pixel */
+    GLuint          tex = 0;    /**< ID representing this texture. 0 until the texture has been loaded */
+    GLuint          palette = 0; /**< ID of the palette texture of a paletted texture, 0 otherwise */
+    sampler_state   sampler;    /**< Filtering and wrapping of this texture */
+    std::size_t     memoryUsage = 0; /**< Video memory used by all levels (and the palette), in bytes */
 };
 
 }}
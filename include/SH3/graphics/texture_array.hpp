@@ -0,0 +1,130 @@
+/** @file
+ *
+ *  Texture array, to keep all textures of a batch (such as the skins of a model) in a single OpenGL texture.
+ *
+ *  @copyright 2016-2019  Palm Studios
+ */
+#ifndef SH3_TEXTURE_ARRAY_HPP_INCLUDED
+#define SH3_TEXTURE_ARRAY_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+namespace sh3 { namespace arc {
+    struct mft;
+} }
+
+namespace sh3 { namespace graphics {
+
+struct texture_image;
+
+/**
+ *  All textures of a batch as the layers of one RGBA @c GL_TEXTURE_2D_ARRAY.
+ *
+ *  The array is as large as the largest texture. Smaller textures sit in the top left corner of their layer, so
+ *  their UVs have to be scaled by @ref layer::uScale and @ref layer::vScale. The array is clamped to its edges
+ *  and has a full mip chain.
+ */
+class CTextureArray final
+{
+public:
+    /**
+     *  Information about one layer of the array.
+     */
+    struct layer final
+    {
+        std::uint16_t width = 0;      /**< Width of the texture. 0 if the texture is broken. */
+        std::uint16_t height = 0;     /**< Height of the texture. 0 if the texture is broken. */
+        GLfloat       uScale = 0.0f;  /**< Width of the texture, relative to the array. */
+        GLfloat       vScale = 0.0f;  /**< Height of the texture, relative to the array. */
+    };
+
+public:
+    /**
+     *  Constructor
+     */
+    CTextureArray(){}
+
+    /**
+     *  Constructor
+     *
+     *  Automatically calls @ref Load()
+     *
+     *  @param mft      Master File Table (for vfile access)
+     *  @param filename Full path of the texture file.
+     */
+    CTextureArray(const sh3::arc::mft& mft, const std::string& filename){Load(mft, filename);}
+
+    /**
+     *  Destructor
+     *
+     *  Deletes the array texture.
+     */
+    ~CTextureArray();
+
+    CTextureArray(const CTextureArray&) = delete;
+    CTextureArray& operator=(const CTextureArray&) = delete;
+
+    /**
+     *  Load all textures of a texture file into the array.
+     *
+     *  The file is read once, its textures are decoded in parallel and uploaded in a single call.
+     *
+     *  @param mft      Master File Table (for vfile access)
+     *  @param filename Full path of the texture file in one of the @c .arc sections.
+     *
+     *  @returns @c true on success, @c false if the file doesn't hold any textures.
+     */
+    bool Load(const sh3::arc::mft& mft, const std::string& filename);
+
+    /**
+     *  Create the array from decoded textures, one layer per texture.
+     *
+     *  @param images The textures. Only level 0 is used; textures without levels get an empty layer.
+     */
+    void Upload(const std::vector<texture_image>& images);
+
+    /**
+     *  Bind the array for use with any draw calls.
+     *
+     *  @param textureUnit The texture unit we want to bind the array to
+     */
+    void Bind(GLenum textureUnit) const;
+
+    /**
+     *  Get the number of layers.
+     */
+    std::size_t GetLayerCount() const {return layers.size();}
+
+    /**
+     *  Get information about a layer.
+     *
+     *  @param i The layer. Must be less than @ref GetLayerCount.
+     */
+    const layer& GetLayer(std::size_t i) const;
+
+    /**
+     *  Get the width of the array.
+     */
+    GLsizei GetWidth() const {return width;}
+
+    /**
+     *  Get the height of the array.
+     */
+    GLsizei GetHeight() const {return height;}
+
+private:
+    GLsizei             width = 0;  /**< Width of each layer. */
+    GLsizei             height = 0; /**< Height of each layer. */
+    std::vector<layer>  layers;     /**< Information about each layer. */
+    GLuint              tex = 0;    /**< The array texture. 0 until a batch has been uploaded. */
+};
+
+}}
+
+#endif // SH3_TEXTURE_ARRAY_HPP_INCLUDED
@@ -0,0 +1,135 @@
+/** @file
+ *
+ *  On-disk cache of decoded textures, so textures from the @c .arc sections only have to be decoded once.
+ *
+ *  @copyright 2016-2019  Palm Studios
+ *
+ *  @note Cached textures are stored in @c data/texcache, one file per texture. The file name is derived from
+ *        the subarc and index of the texture (and the cache version), so it can be found without reading
+ *        anything else. Each file also stores its full key and the size and CRC-32 of the source file, which are
+ *        checked before it is used, so a replaced (e.g. modded) texture is decoded again.
+ */
+#ifndef SH3_TEXTURE_CACHE_HPP_INCLUDED
+#define SH3_TEXTURE_CACHE_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SH3/graphics/palette.hpp"
+
+namespace sh3 { namespace graphics {
+
+/**
+ *  Pixel formats of a @ref texture_image.
+ */
+enum class image_format : std::uint8_t
+{
+    RGBA8,  /**< 32-bit RGBA */
+    BGR8,   /**< 24-bit BGR */
+    RGBA16, /**< 16-bit A1B5G5R5 (see @ref rgba16) */
+    INDEX8, /**< 8-bit indices into @ref texture_image::palette */
+};
+
+/**
+ *  A decoded texture, ready to be uploaded.
+ */
+struct texture_image final
+{
+    /**
+     *  Pixel data of one mip level.
+     */
+    struct level final
+    {
+        const std::uint8_t* data; /**< The pixels. Points into @ref texture_image::storage, or into the file the texture was decoded from. */
+        std::size_t         size; /**< Size of the pixels in bytes. */
+    };
+
+    image_format              format = image_format::RGBA8; /**< Format of the pixels. */
+    std::uint16_t             width = 0;                    /**< Width of level 0. */
+    std::uint16_t             height = 0;                   /**< Height of level 0. */
+    std::vector<level>        levels;                       /**< The mip levels, level 0 first. */
+    expanded_palette          palette{};                    /**< The palette, for @ref image_format::INDEX8. */
+    std::vector<std::uint8_t> storage;                      /**< Storage for pixel data that had to be converted. */
+};
+
+/**
+ *  Get the size of a mip level of a texture.
+ *
+ *  @param format Pixel format of the texture.
+ *  @param width  Width of level 0.
+ *  @param height Height of level 0.
+ *  @param level  The mip level.
+ *
+ *  @returns The size in bytes.
+ */
+std::size_t GetLevelSize(image_format format, std::uint16_t width, std::uint16_t height, std::size_t level);
+
+/**
+ *  Get the number of levels in the full mip chain of a texture.
+ *
+ *  @param width  Width of level 0.
+ *  @param height Height of level 0.
+ */
+std::size_t GetMipLevelCount(std::uint16_t width, std::uint16_t height);
+
+/**
+ *  Add the full mip chain to a texture that only has level 0.
+ *
+ *  Mip levels are made with a box filter. Only @ref image_format::RGBA8 and @ref image_format::BGR8 get mip
+ *  levels; indices can't be filtered, and 16-bit textures are left to the GPU.
+ *
+ *  @param image The texture. Its pixels are moved into @ref texture_image::storage.
+ */
+void BuildMipChain(texture_image& image);
+
+/**
+ *  Convert level 0 of a texture to RGBA8.
+ *
+ *  @param image  The texture.
+ *  @param pixels Set to the converted pixels.
+ */
+void ConvertToRGBA8(const texture_image& image, std::vector<std::uint8_t>& pixels);
+
+/**
+ *  Get the digest of a source file that is stored with its cached texture.
+ *
+ *  @param data First byte of the file.
+ *  @param size Size of the file in bytes.
+ *
+ *  @returns The CRC-32 of the file.
+ */
+std::uint32_t GetSourceDigest(const std::uint8_t* data, std::size_t size);
+
+/**
+ *  Load a texture from the cache.
+ *
+ *  The whole cache file is read at once; the levels of @p image point into its @ref texture_image::storage.
+ *
+ *  @param key          Key of the texture.
+ *  @param sourceSize   Size of the file the texture was decoded from.
+ *  @param sourceDigest @ref GetSourceDigest "Digest" of the file the texture was decoded from.
+ *  @param image        Set to the cached texture.
+ *
+ *  @returns @c true if the texture was in the cache.
+ */
+bool LoadCachedTexture(const std::string& key, std::uint32_t sourceSize, std::uint32_t sourceDigest, texture_image& image);
+
+/**
+ *  Store a texture in the cache.
+ *
+ *  Failing to write the cache is not an error (the data directory might be read-only); a warning is logged.
+ *
+ *  @param key          Key of the texture.
+ *  @param sourceSize   Size of the file the texture was decoded from.
+ *  @param sourceDigest @ref GetSourceDigest "Digest" of the file the texture was decoded from.
+ *  @param image        The decoded texture.
+ *
+ *  @returns @c true if the texture was written.
+ */
+bool StoreCachedTexture(const std::string& key, std::uint32_t sourceSize, std::uint32_t sourceDigest, const texture_image& image);
+
+}}
+
+#endif // SH3_TEXTURE_CACHE_HPP_INCLUDED
@@ -0,0 +1,169 @@
+/** @file
+ *
+ *  Keeps track of the textures loaded from the @c .arc sections and the video memory they use.
+ *
+ *  @copyright 2016-2019  Palm Studios
+ */
+#ifndef SH3_TEXTURE_MANAGER_HPP_INCLUDED
+#define SH3_TEXTURE_MANAGER_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include "SH3/common/singleton.hpp"
+#include "SH3/graphics/texture.hpp"
+
+namespace sh3 { namespace arc {
+    struct mft;
+} }
+
+namespace sh3 { namespace graphics {
+
+/**
+ *  Shares textures between their users, and keeps the video memory they use within a budget.
+ *
+ *  Each texture is loaded once, however many @ref handle "handles" refer to it. Whenever the textures on the GPU
+ *  use more than the budget, the least recently bound ones are unloaded. Unloaded textures are loaded again (from
+ *  the texture cache, so that is quick) the next time they are bound. A texture that has no handles left is
+ *  forgotten once it is unloaded.
+ *
+ *  @note Only use this from the thread owning the GL context, and call @ref Clear before the context goes away
+ *        (@ref sh3::engine::CEngine does so).
+ */
+class CTextureManager final : public CSingleton<CTextureManager>
+{
+    friend class CSingleton<CTextureManager>;
+
+    struct record;
+
+public:
+    static constexpr std::size_t DEFAULT_BUDGET = 256 * 1024 * 1024; /**< Default video memory budget in bytes. */
+
+    /**
+     *  A reference to a texture of the @ref CTextureManager.
+     */
+    class handle final
+    {
+    public:
+        /**
+         *  Constructor. Creates a handle that refers to no texture.
+         */
+        handle() = default;
+
+        handle(const handle& rhs);
+        handle(handle&& rhs) noexcept;
+        ~handle();
+        handle& operator=(handle rhs) noexcept;
+
+        /**
+         *  Bind the texture for use with any draw calls, loading it again if it was unloaded.
+         *
+         *  @param textureUnit The texture unit we want to bind the texture to (see @ref CTexture::Bind)
+         */
+        void Bind(GLenum textureUnit) const;
+
+        /**
+         *  Check whether the texture is paletted (see @ref CTexture::IsPaletted).
+         */
+        bool IsPaletted() const;
+
+        /**
+         *  Check whether this handle refers to a texture.
+         */
+        explicit operator bool() const {return rec != nullptr;}
+
+    private:
+        friend class CTextureManager;
+
+        explicit handle(record* r);
+
+        record* rec = nullptr; /**< The texture. */
+    };
+
+public:
+    /**
+     *  Destructor. The singleton outlives the GL context, so this only complains about textures that weren't
+     *  @ref Clear "cleared".
+     */
+    ~CTextureManager();
+
+    /**
+     *  Unload all textures and forget the ones without @ref handle "handles". Textures still referred to are
+     *  loaded again when they are bound.
+     */
+    void Clear();
+
+    /**
+     *  Get a texture, loading it if it isn't loaded yet.
+     *
+     *  @param mft      Master File Table (for vfile access). Must stay alive as long as the texture is used.
+     *  @param filename Full path of the texture in one of the @c .arc sections
+     *
+     *  @returns A @ref handle to the texture.
+     */
+    handle Get(const sh3::arc::mft& mft, const std::string& filename);
+
+    /**
+     *  Set the video memory budget. Textures are unloaded right away if it is exceeded.
+     *
+     *  @param bytes The budget in bytes.
+     */
+    void SetBudget(std::size_t bytes);
+
+    /**
+     *  Get the video memory used by the loaded textures, in bytes.
+     */
+    std::size_t GetMemoryUsage() const {return memoryUsage;}
+
+private:
+    /**
+     *  A texture and its users.
+     */
+    struct record final
+    {
+        const sh3::arc::mft*    mft = nullptr;  /**< Where the texture is loaded from. */
+        std::string             filename;       /**< Path of the texture. */
+        CTexture                texture;        /**< The texture. Not loaded while it is evicted. */
+        bool                    paletted = false; /**< Whether the texture is paletted (also known while it is evicted). */
+        bool                    broken = false; /**< Set if the texture could not be loaded. */
+        std::size_t             refs = 0;       /**< Number of @ref handle "handles" to the texture. */
+        std::uint64_t           lastUsed = 0;   /**< Value of @ref clock when the texture was last bound. */
+    };
+
+    /**
+     *  Constructor
+     */
+    CTextureManager() = default;
+
+    /**
+     *  Load a texture if it isn't loaded, and mark it as used.
+     */
+    void Use(record& rec);
+
+    /**
+     *  Drop a reference to a texture.
+     */
+    void Release(record& rec);
+
+    /**
+     *  Unload the least recently used textures until the budget is kept.
+     *
+     *  @param keep A texture that must not be unloaded.
+     */
+    void Evict(const record* keep);
+
+    std::map<std::string, std::unique_ptr<record>>  records;                    /**< All textures, by path. */
+    std::size_t                                     budget = DEFAULT_BUDGET;    /**< The video memory budget in bytes. */
+    std::size_t                                     memoryUsage = 0;            /**< Video memory used by the loaded textures. */
+    std::uint64_t                                   clock = 0;                  /**< Counts the textures bound, to find the least recently used one. */
+};
+
+}}
+
+#endif // SH3_TEXTURE_MANAGER_HPP_INCLUDED
@@ -0,0 +1,107 @@
+/** @file
+ *
+ *  Streaming of texture data to the GPU through pixel unpack buffers.
+ *
+ *  @copyright 2016-2019  Palm Studios
+ */
+#ifndef SH3_TEXTURE_UPLOAD_HPP_INCLUDED
+#define SH3_TEXTURE_UPLOAD_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include "SH3/common/singleton.hpp"
+
+namespace sh3 { namespace graphics {
+
+/**
+ *  Uploads texture data through a persistently mapped pixel unpack buffer, used as a ring.
+ *
+ *  Pixels are copied into the ring and @c glTexSubImage2D reads them from there, so the call returns without
+ *  waiting for the driver to copy the pixels out of our memory. Each upload is followed by a fence; the part of the
+ *  ring it used is reused once the fence has signalled.
+ *
+ *  If the GL has no @c ARB_buffer_storage, or the ring is full (or too small for the texture), the pixels are
+ *  uploaded straight from client memory instead, as @c CTexture did before.
+ *
+ *  @note Only use this from the thread owning the GL context. The instance has to be created while the context
+ *        is current, i.e. not before @ref sh3::engine::CEngine::Init, and @ref Shutdown has to be called before the
+ *        context goes away (@ref sh3::engine::CEngine does so).
+ */
+class CTextureUploader final : public CSingleton<CTextureUploader>
+{
+    friend class CSingleton<CTextureUploader>;
+
+public:
+    static constexpr std::size_t RING_SIZE = 16 * 1024 * 1024; /**< Size of the ring in bytes. */
+
+public:
+    /**
+     *  Destructor. The singleton outlives the GL context, so this only complains if @ref Shutdown wasn't called.
+     */
+    ~CTextureUploader();
+
+    /**
+     *  Wait for all uploads and delete the ring. Later uploads are done straight from client memory.
+     */
+    void Shutdown();
+
+    /**
+     *  Upload a whole mip level of the texture bound to @c GL_TEXTURE_2D.
+     *
+     *  The storage of the level has to exist already (@c glTexImage2D with no data, or @c glTexStorage2D).
+     *
+     *  @param level  The mip level.
+     *  @param width  Width of the level.
+     *  @param height Height of the level.
+     *  @param format Format of the pixels (as for @c glTexSubImage2D).
+     *  @param type   Type of the pixels (as for @c glTexSubImage2D).
+     *  @param pixels The pixels. Rows must not be padded.
+     *  @param size   Size of the pixels in bytes.
+     */
+    void Upload(GLint level, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, std::size_t size);
+
+    /**
+     *  Free the parts of the ring used by finished uploads. Call this once per frame.
+     */
+    void Poll();
+
+private:
+    /**
+     *  Part of the ring that is still read by the GPU.
+     */
+    struct in_flight final
+    {
+        GLsync      fence; /**< Signalled when the upload is done. */
+        std::size_t begin; /**< Offset of the first byte used. */
+        std::size_t end;   /**< Offset after the last byte used. */
+    };
+
+    /**
+     *  Constructor. Creates and maps the ring, if possible.
+     */
+    CTextureUploader();
+
+    /**
+     *  Find room in the ring.
+     *
+     *  @param size   Number of bytes needed.
+     *  @param offset Set to the offset of the room.
+     *
+     *  @returns @c true if there is room, @c false if the ring is full.
+     */
+    bool Allocate(std::size_t size, std::size_t& offset);
+
+    GLuint                  pbo = 0;            /**< The ring buffer. 0 if it couldn't be created. */
+    std::uint8_t*           mapping = nullptr;  /**< Where @ref pbo is mapped. */
+    std::size_t             head = 0;           /**< Offset of the next upload. */
+    std::deque<in_flight>   inFlight;           /**< Uploads the GPU might not have finished, oldest first. */
+};
+
+}}
+
+#endif // SH3_TEXTURE_UPLOAD_HPP_INCLUDED
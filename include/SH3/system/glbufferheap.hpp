@@ -0,0 +1,170 @@
+/** @file
+ *
+ *  Sub-allocation of a few large buffer objects, so static geometry doesn't need a buffer object per mesh.
+ *
+ *  @copyright 2016-2019 Palm Studios
+ */
+#ifndef SH3_GLBUFFERHEAP_HPP_INCLUDED
+#define SH3_GLBUFFERHEAP_HPP_INCLUDED
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "SH3/system/glvertexbuffer.hpp"
+
+namespace sh3 { namespace gl {
+
+/**
+ * A heap of GPU memory for one buffer target.
+ *
+ * Memory comes from large buffer objects ("blocks"), which are created as needed. Each allocation is a range of
+ * one block, so all meshes in a block can share a VAO and only differ in their base vertex and first index.
+ *
+ * Free ranges of each block are kept by offset (to merge neighbours when a range is freed) and by size (to find the
+ * smallest range that fits, which keeps the heap from fragmenting much).
+ *
+ * @note This class <i>CANNOT</i> be inherited from!
+ */
+struct CBufferHeap final
+{
+public:
+    static constexpr GLsizeiptr DEFAULT_BLOCK_SIZE = 32 * 1024 * 1024; /**< Default size of each block */
+
+    /**
+     * Range of a block handed out by @ref Allocate.
+     */
+    struct allocation final
+    {
+        GLuint      buffer = 0;     /**< The buffer object (block) this range is in. 0 if the allocation failed */
+        GLintptr    offset = 0;     /**< Offset of the range in @ref buffer */
+        GLsizeiptr  size = 0;       /**< Size of the range in bytes */
+
+        /**
+         * Check whether this allocation succeeded.
+         */
+        explicit operator bool() const {return buffer != 0;}
+
+        /**
+         * Get the index of the first vertex of this range, for @c glDrawElementsBaseVertex.
+         *
+         * @param stride Size of a vertex. The allocation must have been aligned to it.
+         */
+        GLint GetBaseVertex(GLsizei stride) const {return static_cast<GLint>(offset / stride);}
+    };
+
+public:
+    /**
+     * Constructor. Blocks are only created once they are needed.
+     *
+     * @param target    The target the blocks are used for, e.g. @ref CVertexBuffer::ARRAY_BUFFER or @ref CVertexBuffer::ELEMENT_ARRAY
+     * @param blockSize Size of each block. Larger allocations get a block of their own
+     * @param name      Name of this heap
+     */
+    CBufferHeap(CVertexBuffer::BufferTarget target, GLsizeiptr blockSize = DEFAULT_BLOCK_SIZE, const std::string& name = "DEFAULT_BUFFER_HEAP");
+
+    /**
+     * Copy Constructor
+     *
+     * @warning A heap cannot be copied.
+     */
+    CBufferHeap(const CBufferHeap& rhs) = delete;
+
+    CBufferHeap& operator=(const CBufferHeap& rhs) = delete;
+
+    /**
+     * Destructor. Deletes all blocks; all allocations are invalid afterwards.
+     */
+    ~CBufferHeap();
+
+    /**
+     * Allocate a range of GPU memory.
+     *
+     * @param size      Size of the range in bytes
+     * @param alignment Alignment of the offset of the range. Use the size of a vertex for vertex data, so the
+     *                  range can be drawn with a base vertex. Doesn't have to be a power of two
+     *
+     * @return The range. It is empty if no memory could be allocated.
+     */
+    allocation Allocate(GLsizeiptr size, GLsizeiptr alignment = 4);
+
+    /**
+     * Give a range back to the heap.
+     *
+     * @param alloc A range handed out by @ref Allocate of this heap. Empty ranges are ignored.
+     */
+    void Free(const allocation& alloc);
+
+    /**
+     * Copy data into (part of) a range.
+     *
+     * @param alloc  The range
+     * @param offset Offset into the range to start writing
+     * @param size   Number of bytes to write. Must fit into the range
+     * @param data   The data to write
+     */
+    void Upload(const allocation& alloc, GLintptr offset, GLsizeiptr size, const void* data);
+
+    /**
+     * Get the number of blocks.
+     */
+    std::size_t GetBlockCount() const {return blocks.size();}
+
+    /**
+     * Get the number of bytes that are allocated.
+     */
+    GLsizeiptr GetUsedSize() const {return used;}
+
+    /**
+     * Get the target the blocks are used for.
+     */
+    CVertexBuffer::BufferTarget GetTarget() const {return target;}
+
+    /**
+     * Get the name of this heap
+     */
+    const std::string& GetName() const {return name;}
+
+private:
+    /**
+     * A buffer object and its free ranges.
+     */
+    struct block final
+    {
+        GLuint                                  buffer = 0;     /**< ID of the Buffer Object given to us by OpenGL */
+        GLsizeiptr                              size = 0;       /**< Size of the buffer */
+        std::map<GLintptr, GLsizeiptr>          freeByOffset;   /**< Free ranges, offset -> size */
+        std::multimap<GLsizeiptr, GLintptr>     freeBySize;     /**< Free ranges, size -> offset */
+    };
+
+    /**
+     * Try to allocate from a block.
+     *
+     * @return The range. It is empty if the block has no room.
+     */
+    allocation Allocate(block& b, GLsizeiptr size, GLsizeiptr alignment);
+
+    /**
+     * Add a free range to a block, merging it with free neighbours.
+     */
+    static void AddFreeRange(block& b, GLintptr offset, GLsizeiptr size);
+
+    /**
+     * Remove a free range from the size index of a block.
+     */
+    static void EraseBySize(block& b, GLintptr offset, GLsizeiptr size);
+
+    std::string                 name;           /**< Name of this heap */
+    CVertexBuffer::BufferTarget target;         /**< The target the blocks are used for */
+    GLsizeiptr                  blockSize;      /**< Size of new blocks */
+    GLsizeiptr                  used = 0;       /**< Bytes handed out */
+    std::vector<block>          blocks;         /**< All blocks, oldest first */
+};
+
+}}
+
+#endif // SH3_GLBUFFERHEAP_HPP_INCLUDED
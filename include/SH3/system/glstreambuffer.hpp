@@ -0,0 +1,154 @@
+/** @file
+ *
+ *  Ring buffer for vertex data that changes every frame (HUD, particles, debug lines, text).
+ *
+ *  @copyright 2016-2019 Palm Studios
+ */
+#ifndef SH3_GLSTREAMBUFFER_HPP_INCLUDED
+#define SH3_GLSTREAMBUFFER_HPP_INCLUDED
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SH3/system/glvertexbuffer.hpp"
+
+namespace sh3 { namespace gl {
+
+/**
+ * A buffer object split into one region per frame in flight.
+ *
+ * Each frame, geometry is written into slices handed out by @ref Allocate, which just bumps an offset in the
+ * region of the current frame. @ref EndFrame puts a fence after the draws of the frame, and @ref BeginFrame waits
+ * for the fence of the region it is about to reuse (which is usually long signalled). So writing vertices needs
+ * neither a driver allocation nor an implicit synchronization.
+ *
+ * The buffer is mapped persistently and coherently, so slices can be drawn from as soon as they are written. If the
+ * driver refuses to map it, slices are staged in system memory instead, and @ref Flush uploads them.
+ *
+ * Everything except @ref Bind goes through direct state access, so the element buffer of a bound VAO is left alone.
+ *
+ * @note This class <i>CANNOT</i> be inherited from!
+ */
+struct CStreamBuffer final
+{
+public:
+    static constexpr std::size_t DEFAULT_FRAMES = 3; /**< Frames the CPU can be ahead of the GPU by default */
+
+    /**
+     * Part of the buffer handed out by @ref Allocate.
+     */
+    struct slice final
+    {
+        GLintptr    offset = 0;         /**< Offset of the slice in the buffer (to use with @ref Bind) */
+        void*       data = nullptr;     /**< Where to write the slice. @c nullptr if the region was full */
+        GLsizeiptr  size = 0;           /**< Size of the slice in bytes */
+
+        /**
+         * Check whether this slice could be allocated.
+         */
+        explicit operator bool() const {return data != nullptr;}
+    };
+
+public:
+    /**
+     * Constructor. Creates (and maps) the buffer.
+     *
+     * @param target    The target this buffer is used for, usually @ref CVertexBuffer::ARRAY_BUFFER
+     * @param frameSize Bytes available to each frame
+     * @param numFrames Number of regions, i.e. frames the CPU can be ahead of the GPU
+     * @param name      Name of this buffer
+     */
+    CStreamBuffer(CVertexBuffer::BufferTarget target, GLsizeiptr frameSize, std::size_t numFrames = DEFAULT_FRAMES, const std::string& name = "DEFAULT_STREAM_BUFFER");
+
+    /**
+     * Copy Constructor
+     *
+     * @warning A buffer cannot be copied.
+     */
+    CStreamBuffer(const CStreamBuffer& rhs) = delete;
+
+    CStreamBuffer& operator=(const CStreamBuffer& rhs) = delete;
+
+    /**
+     * Destructor. Waits for the GPU to finish with the buffer and deletes it.
+     */
+    ~CStreamBuffer();
+
+    /**
+     * Start writing the next frame. Waits for the GPU if it is still reading the region of this frame.
+     */
+    void BeginFrame();
+
+    /**
+     * Hand out a slice of the region of the current frame.
+     *
+     * @param size      Size of the slice in bytes
+     * @param alignment Alignment of the offset of the slice (e.g. the size of a vertex)
+     *
+     * @return The slice. It is empty if the region has no room left for this frame.
+     */
+    slice Allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+
+    /**
+     * Make the slices written so far available to the GPU. Call this before drawing from them.
+     *
+     * This does nothing if the buffer is mapped persistently.
+     */
+    void Flush();
+
+    /**
+     * Finish the current frame, after its last draw from this buffer.
+     */
+    void EndFrame();
+
+    /**
+     * Bind this buffer to its target.
+     */
+    void Bind(void) const noexcept{glBindBuffer(target, vboID);}
+
+    /**
+     * Returns this buffer's OpenGL generated ID
+     */
+    GLuint Get() const {return vboID;}
+
+    /**
+     * Get the target this buffer is used for.
+     */
+    CVertexBuffer::BufferTarget GetTarget() const {return target;}
+
+    /**
+     * Get the number of bytes available to each frame.
+     */
+    GLsizeiptr GetFrameSize() const {return frameSize;}
+
+    /**
+     * Get the name of this buffer
+     */
+    const std::string& GetName() const {return name;}
+
+private:
+    /**
+     * Get the offset of the region of the current frame.
+     */
+    GLintptr GetFrameOffset() const {return static_cast<GLintptr>(frame) * frameSize;}
+
+    GLuint                      vboID = 0;          /**< ID of the Buffer Object given to us by OpenGL */
+    std::string                 name;               /**< Name of this buffer */
+    CVertexBuffer::BufferTarget target;             /**< The target that this buffer is to used for */
+    GLsizeiptr                  frameSize;          /**< Size of the region of each frame */
+    std::vector<GLsync>         fences;             /**< Fence after the last draw of each region, 0 if there is none */
+    std::size_t                 frame = 0;          /**< Region of the current frame */
+    GLsizeiptr                  head = 0;           /**< Bytes of the current region handed out so far */
+    GLsizeiptr                  flushed = 0;        /**< Bytes of the current region that have been uploaded (without a mapping) */
+    std::uint8_t*               mapping = nullptr;  /**< Where the buffer is mapped, @c nullptr if it isn't */
+    std::vector<std::uint8_t>   staging;            /**< The current region, if the buffer isn't mapped */
+};
+
+}}
+
+#endif // SH3_GLSTREAMBUFFER_HPP_INCLUDED
@@ -31,6 +31,7 @@
 #include <string>
 
 #include "SH3/system/glvertexbuffer.hpp"
+#include "SH3/system/glvertexlayout.hpp"
 
 namespace sh3{ namespace gl{
 
@@ -99,19 +100,32 @@ public:
 
     /**
      * Copy Constructor
+     *
+     * @warning A VAO cannot be copied, as it owns its OpenGL object.
      */
-    CVertexArray(const CVertexArray& rhs);
+    CVertexArray(const CVertexArray& rhs) = delete;
 
     /**
      * Move constructor
+     *
+     * Takes over the VAO of @p rhs, which is left without one.
      */
-    CVertexArray(CVertexArray&& rhs);
+    CVertexArray(CVertexArray&& rhs) noexcept;
 
     /**
      * Destructor. Will automatically cleanup and free VAO;
      */
     ~CVertexArray();
 
+    CVertexArray& operator=(const CVertexArray& rhs) = delete;
+
+    /**
+     * Move assignment operator
+     *
+     * Deletes the VAO of this object, then takes over the one of @p rhs, which is left without one.
+     */
+    CVertexArray& operator=(CVertexArray&& rhs) noexcept;
+
     /**
      * Create a new Vertex Array Object and store in @ref vaoID
      */
@@ -144,6 +158,46 @@ public:
      */
     void BindAttribute(const GLuint idx, const CVertexBuffer& vbo, GLint size, GLboolean normalize, GLsizei stride, GLintptr offset, VertexAttribute::AttributeType type);
 
+    /**
+     * Set up the attribute formats of this VAO from a @ref vertex_layout.
+     *
+     * This only describes the vertices; the buffer they come from is set with @ref BindVertexBuffer, so the VAO
+     * can be reused for every mesh with the same layout.
+     *
+     * @tparam Layout   The @ref vertex_layout
+     * @param binding   The buffer binding point the attributes read from
+     */
+    template<typename Layout>
+    void SetLayout(GLuint binding = 0){Layout::Apply(vaoID, binding);}
+
+    /**
+     * Attach a buffer of interleaved vertices to a buffer binding point.
+     *
+     * @param buffer    The buffer object
+     * @param offset    Offset of the first vertex in the buffer
+     * @param stride    Distance between two vertices
+     * @param binding   The buffer binding point
+     */
+    void BindVertexBuffer(GLuint buffer, GLintptr offset, GLsizei stride, GLuint binding = 0);
+
+    /**
+     * Attach a buffer of interleaved vertices, laid out as in @p Layout, to a buffer binding point.
+     *
+     * @tparam Layout   The @ref vertex_layout of the vertices
+     * @param vbo       The buffer
+     * @param offset    Offset of the first vertex in the buffer
+     * @param binding   The buffer binding point
+     */
+    template<typename Layout>
+    void BindVertexBuffer(const CVertexBuffer& vbo, GLintptr offset = 0, GLuint binding = 0){BindVertexBuffer(vbo.Get(), offset, Layout::stride, binding);}
+
+    /**
+     * Attach an index buffer to this VAO.
+     *
+     * @param buffer    The buffer object
+     */
+    void BindElementBuffer(GLuint buffer);
+
     /**
      * Bind this VAO as the current one in use by the OpenGL state machine.
      */
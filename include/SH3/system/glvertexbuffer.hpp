@@ -18,6 +18,21 @@
 #include <string>
 #include <vector>
 
+/**
+ *  Keep a copy of the contents of every @ref sh3::gl::CVertexBuffer in system memory, so buffers can be inspected
+ *  on the CPU without a GL debugger (like CodeXL).
+ *
+ *  This doubles the memory used by buffers and adds a copy to every upload, so it is only on in debug builds by default.
+ *  Define it to 0 or 1 to override this.
+ */
+#ifndef SH3_GL_SHADOW_COPY
+#ifdef SH3_DEBUG
+#define SH3_GL_SHADOW_COPY 1
+#else
+#define SH3_GL_SHADOW_COPY 0
+#endif
+#endif
+
 namespace sh3 { namespace gl {
 
 struct CVertexBuffer final
@@ -108,9 +123,9 @@ public:
     /**
      * Move constructor
      *
-     * @warning A buffer cannot be moved.
+     * Takes over the buffer object of @p rhs, which is left without one.
      */
-    CVertexBuffer(CVertexBuffer&& rhs) = delete;
+    CVertexBuffer(CVertexBuffer&& rhs) noexcept;
 
     /**
      *
@@ -164,6 +179,26 @@ public:
      */
     void BufferSubData(GLintptr offset, GLsizeiptr size, const GLvoid* data);
 
+    /**
+     * Map part of this buffer into client memory, so it can be written (or read) without an extra copy.
+     *
+     * The buffer must have been filled with @ref BufferData first, and must not be used by the GL until @ref Unmap is called.
+     *
+     * @param offset    Offset into the buffer of the first byte to map
+     * @param length    Number of bytes to map
+     * @param access    Combination of @c GL_MAP_*_BIT flags, as for @c glMapBufferRange
+     *
+     * @return Pointer to the mapped bytes, or @c nullptr if the buffer couldn't be mapped.
+     */
+    void* Map(GLintptr offset, GLsizeiptr length, GLbitfield access);
+
+    /**
+     * Unmap the buffer after a call to @ref Map. The pointer returned by @ref Map is invalid afterwards.
+     *
+     * @return @c false if the contents of the buffer were lost while it was mapped (and have to be uploaded again).
+     */
+    bool Unmap();
+
     /**
      * Bind this buffer to a @ref BufferTarget target, making this VBO the active VBO.
      *
@@ -196,16 +231,27 @@ public:
      */
     BufferTarget GetTarget() const{return target;}
 
-    const void* const Data(void) const{return reinterpret_cast<const GLubyte*>(data.data());}
+    /**
+     * Get the copy of this buffer in system memory.
+     *
+     * @return The copy, or @c nullptr if @ref SH3_GL_SHADOW_COPY is off.
+     */
+#if SH3_GL_SHADOW_COPY
+    const void* Data(void) const{return data.data();}
+#else
+    const void* Data(void) const{return nullptr;}
+#endif
+
+    CVertexBuffer& operator=(const CVertexBuffer& rhs) = delete;
 
     /**
-     * Operator= overload
+     * Move assignment operator
      *
-     * Copies rhs into this Vertex Buffer
+     * Deletes the buffer object of this buffer, then takes over the one of @p rhs, which is left without one.
      *
      * @return Returns this CVertexBuffer
      */
-    const CVertexBuffer& operator=(const CVertexBuffer& rhs);
+    CVertexBuffer& operator=(CVertexBuffer&& rhs) noexcept;
 
     /**
      * Get the name of this VAO
@@ -217,7 +263,13 @@ private:
     std::string             name;           /**< Name of this vertex buffer */
     BufferTarget            target;         /**< The target that this buffer is to used for */
 
+    GLintptr                mapOffset = 0;  /**< Offset of the range mapped by @ref Map */
+    GLsizeiptr              mapLength = 0;  /**< Length of the range mapped by @ref Map. 0 if the buffer isn't mapped */
+    GLbitfield              mapAccess = 0;  /**< Access flags of the range mapped by @ref Map */
+
+#if SH3_GL_SHADOW_COPY
     std::vector<GLubyte>    data;           /**< Local data store of this buffer (so we can debug on the CPU without a need for a GL debugger [like CodeXL]) */
+#endif
 };
 
 
@@ -0,0 +1,129 @@
+/** @file
+ *
+ *  Compile-time description of interleaved vertex types, used to set up the attribute formats of a
+ *  @ref sh3::gl::CVertexArray.
+ *
+ *  A layout lists the attributes of one vertex struct, each with its location (as in <tt>layout(location = n)</tt>
+ *  in the vertex shader), its type and its offset in the struct:
+ *
+ *      using model_vertex_layout = vertex_layout<sh3_model_vertex,
+ *                                                vertex_attrib<0, vertex3f, offsetof(sh3_model_vertex, vertex)>,
+ *                                                vertex_attrib<2, vertex3f, offsetof(sh3_model_vertex, normal)>,
+ *                                                vertex_attrib<1, texcoord, offsetof(sh3_model_vertex, uvcoord)>>;
+ *
+ *  The number of components and the GL type of each attribute are worked out from its type, see @ref attrib_traits.
+ *  All vertices of a mesh then go into one buffer, and since the format of a VAO is kept apart from its buffers,
+ *  one VAO can be used for all meshes with the same layout.
+ *
+ *  @copyright 2016-2019 Palm Studios
+ */
+#ifndef SH3_GLVERTEXLAYOUT_HPP_INCLUDED
+#define SH3_GLVERTEXLAYOUT_HPP_INCLUDED
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+
+#include <cstddef>
+
+#include "SH3/types/vertex.hpp"
+
+namespace sh3 { namespace gl {
+
+/**
+ * Number of components and GL type of a vertex attribute type. Specialise this for new attribute types.
+ */
+template<typename T>
+struct attrib_traits;
+
+template<>
+struct attrib_traits<GLfloat>
+{
+    static constexpr GLint  size = 1;           /**< Number of components */
+    static constexpr GLenum type = GL_FLOAT;    /**< Type of each component */
+};
+
+template<>
+struct attrib_traits<texcoord>
+{
+    static constexpr GLint  size = 2;           /**< Number of components */
+    static constexpr GLenum type = GL_FLOAT;    /**< Type of each component */
+};
+
+template<>
+struct attrib_traits<vertex3f>
+{
+    static constexpr GLint  size = 3;           /**< Number of components */
+    static constexpr GLenum type = GL_FLOAT;    /**< Type of each component */
+};
+
+/**
+ * One attribute of a @ref vertex_layout.
+ *
+ * @tparam Location  Location of the attribute in the vertex shader
+ * @tparam T         Type of the attribute in the vertex struct
+ * @tparam Offset    Offset of the attribute in the vertex struct (use @c offsetof)
+ * @tparam Normalize Should integer data be normalized by the GPU?
+ */
+template<GLuint Location, typename T, std::size_t Offset, GLboolean Normalize = GL_FALSE>
+struct vertex_attrib final
+{
+    using type = T;
+
+    static constexpr GLuint    location = Location;                     /**< Location in the vertex shader */
+    static constexpr GLint     size = attrib_traits<T>::size;           /**< Number of components */
+    static constexpr GLenum    componentType = attrib_traits<T>::type;  /**< Type of each component */
+    static constexpr GLuint    offset = static_cast<GLuint>(Offset);    /**< Offset in the vertex struct */
+    static constexpr GLboolean normalize = Normalize;                   /**< Should integer data be normalized? */
+};
+
+/**
+ * Layout of an interleaved vertex struct.
+ *
+ * @tparam Vertex  The vertex struct
+ * @tparam Attribs The @ref vertex_attrib "attributes" of the struct
+ */
+template<typename Vertex, typename... Attribs>
+struct vertex_layout final
+{
+    static_assert(sizeof...(Attribs) > 0, "A vertex layout needs at least one attribute");
+    static_assert(((Attribs::offset + sizeof(typename Attribs::type) <= sizeof(Vertex)) && ...), "Attribute lies outside of the vertex");
+
+    using vertex = Vertex;
+
+    static constexpr GLsizei stride = static_cast<GLsizei>(sizeof(Vertex)); /**< Distance between two vertices in a buffer */
+
+    /**
+     * Set up the attribute formats of a VAO, reading all attributes from one buffer binding point.
+     *
+     * @param vao     The VAO
+     * @param binding The buffer binding point the attributes read from
+     */
+    static void Apply(GLuint vao, GLuint binding)
+    {
+        (ApplyAttrib<Attribs>(vao, binding), ...);
+    }
+
+private:
+    /**
+     * Set up the format of one attribute.
+     */
+    template<typename Attrib>
+    static void ApplyAttrib(GLuint vao, GLuint binding)
+    {
+        glEnableVertexArrayAttrib(vao, Attrib::location);
+        glVertexArrayAttribFormat(vao, Attrib::location, Attrib::size, Attrib::componentType, Attrib::normalize, Attrib::offset);
+        glVertexArrayAttribBinding(vao, Attrib::location, binding);
+    }
+};
+
+/**
+ * Layout of @ref sh3_model_vertex. Positions are at location 0, UVs at 1 (as in the @c image shader) and normals at 2.
+ */
+using model_vertex_layout = vertex_layout<sh3_model_vertex,
+                                          vertex_attrib<0, vertex3f, offsetof(sh3_model_vertex, vertex)>,
+                                          vertex_attrib<2, vertex3f, offsetof(sh3_model_vertex, normal)>,
+                                          vertex_attrib<1, texcoord, offsetof(sh3_model_vertex, uvcoord)>>;
+
+}}
+
+#endif // SH3_GLVERTEXLAYOUT_HPP_INCLUDED
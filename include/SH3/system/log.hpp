@@ -32,6 +32,8 @@ enum class LogLevel
  *
  *  @param logType The @ref LogLevel to log with.
  *  @param str     Formatted string to print.
+ *
+ *  @note Safe to call from any thread; messages are written one at a time.
  */
 [[gnu::format(printf, 2, 3)]] void Log(LogLevel logType, const char* str, ...);
 
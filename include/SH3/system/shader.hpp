@@ -83,6 +83,20 @@ public:
      */
     CShader(const std::string& _name, const std::vector<ShaderAttribute>& _attribs);
 
+    /**
+     * Copy constructor
+     *
+     * @warning A shader cannot be copied, as it owns its program object.
+     */
+    CShader(const CShader& rhs) = delete;
+
+    /**
+     * Move constructor
+     *
+     * Takes over the program object of @p rhs, which is left without one.
+     */
+    CShader(CShader&& rhs) noexcept;
+
     /**
      * Destructor
      *
@@ -90,6 +104,15 @@ public:
      */
     ~CShader();
 
+    CShader& operator=(const CShader& rhs) = delete;
+
+    /**
+     * Move assignment operator
+     *
+     * Deletes the program object of this shader, then takes over the one of @p rhs, which is left without one.
+     */
+    CShader& operator=(CShader&& rhs) noexcept;
+
     /**
      * Binds this program as the current program in use by the current OpenGL context.
      *
@@ -173,7 +196,8 @@ public:
     /**
      * Load the shader source from disk and compile it.
      *
-     * The shader objects are then linked together to form our final Shader Program (stored in @ref program)
+     * The shader objects are then linked together to form our final Shader Program (stored in @ref program).
+     * A program loaded before is deleted.
      *
      * @param name Name of the shader we want to load from /data/shaders/
      */
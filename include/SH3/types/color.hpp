@@ -26,17 +26,23 @@ struct rgba
     std::uint8_t r, g, b, a;
 };
 
-/*
- *  RGBA16 pixel
+/**
+ *  RGBA16 pixel, as stored by the PS2 (A1B5G5R5: red in the lowest 5 bits, alpha in the highest bit)
+ *
+ *  This matches @c GL_RGBA with @c GL_UNSIGNED_SHORT_1_5_5_5_REV.
  */
 struct rgba16
 {
-    std::uint8_t r : 5;
-    std::uint8_t g : 5;
-    std::uint8_t b : 5;
-    std::uint8_t a : 1;
+    std::uint16_t value;
+
+    std::uint8_t r() const { return static_cast<std::uint8_t>(value & 0x1fu); }         /**< Red, 0-31 */
+    std::uint8_t g() const { return static_cast<std::uint8_t>((value >> 5) & 0x1fu); }  /**< Green, 0-31 */
+    std::uint8_t b() const { return static_cast<std::uint8_t>((value >> 10) & 0x1fu); } /**< Blue, 0-31 */
+    std::uint8_t a() const { return static_cast<std::uint8_t>(value >> 15); }           /**< Alpha, 0-1 */
 };
 
+static_assert(sizeof(rgba16) == 2, "struct has been padded on this compiler!");
+
 /**
  *  RGB24 pixel
  */
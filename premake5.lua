@@ -25,7 +25,7 @@ project "sh3r"
     filter {"system:not windows"}
         libdirs {"libs/SDL2-2.0.9/build", "libs/zlib-1.2.11/build", "libs/glew-2.1.0/build/lib"}
         sysincludedirs {"libs/SDL2-2.0.9/include", "libs/glew-2.1.0/include", "libs/boost_1_69_0", "libs/glm/include"}
-        links {"z", "SDL2", "GLEW"}
+        links {"z", "SDL2", "GLEW", "pthread"}
         links {"GL"}
 
     filter "configurations:Debug"
@@ -68,7 +68,7 @@ project "tex"
     filter {"system:not windows"}
         libdirs {"libs/SDL2-2.0.9/build", "libs/zlib-1.2.11/build", "libs/glew-2.1.0/build/lib"}
         sysincludedirs {"libs/SDL2-2.0.9/include", "libs/glew-2.1.0/include", "libs/boost_1_69_0", "libs/glm/include"}
-        links {"z", "SDL2", "GLEW"}
+        links {"z", "SDL2", "GLEW", "pthread"}
         links {"GL"}
 
     filter "configurations:Debug"
@@ -0,0 +1,135 @@
+/** @file
+ *  Implementation of file_index.hpp
+ *
+ *  @copyright 2016-2019 Palm Studios
+ */
+#include "SH3/arc/file_index.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "SH3/system/assert.hpp"
+
+using namespace sh3::arc;
+
+namespace {
+    static constexpr std::size_t minCapacity = 64; /**< Smallest number of slots allocated. */
+
+    /**
+     *  Get the number of slots needed to hold @p numFiles entries at a load factor of at most 1/2.
+     */
+    std::size_t CapacityFor(std::size_t numFiles)
+    {
+        std::size_t capacity = minCapacity;
+        while(capacity < numFiles * 2)
+        {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+}
+
+file_index::hash_t file_index::Hash(std::string_view str) noexcept
+{
+    static constexpr hash_t offsetBasis = 0xcbf29ce484222325u;
+    static constexpr hash_t prime = 0x100000001b3u;
+
+    hash_t hash = offsetBasis;
+    for(char c : str)
+    {
+        hash ^= static_cast<std::uint8_t>(c);
+        hash *= prime;
+    }
+    return hash;
+}
+
+void file_index::Reserve(std::size_t numFiles)
+{
+    const std::size_t capacity = CapacityFor(numFiles);
+    if(capacity > numSlots)
+    {
+        Rehash(capacity);
+    }
+}
+
+bool file_index::Insert(const file_record& record, subarc_id subarc)
+{
+    ASSERT(arena != nullptr && subarc != noSubarc);
+    ASSERT(slots == nullptr || slots == storage.data()); // Slots viewed elsewhere can't be changed
+
+    if((count + 1) * 2 > numSlots)
+    {
+        Rehash(CapacityFor(count + 1));
+    }
+
+    const std::string_view name(arena + record.name, record.nameLength);
+    const hash_t hash = Hash(name);
+    entry& slot = storage[Probe(name, hash)];
+    if(slot.subarc != noSubarc)
+    {
+        return false;
+    }
+
+    slot = {hash, record.name, record.nameLength, subarc, record.index};
+    ++count;
+    return true;
+}
+
+const file_index::entry* file_index::Find(std::string_view name) const
+{
+    if(numSlots == 0)
+    {
+        return nullptr;
+    }
+
+    const entry& slot = slots[Probe(name, Hash(name))];
+    return slot.subarc != noSubarc ? &slot : nullptr;
+}
+
+std::size_t file_index::Probe(std::string_view name, hash_t hash) const
+{
+    ASSERT(numSlots != 0);
+    const std::size_t mask = numSlots - 1;
+
+    // There is always an empty slot, so this always terminates.
+    for(std::size_t i = static_cast<std::size_t>(hash) & mask;; i = (i + 1) & mask)
+    {
+        const entry& slot = slots[i];
+        if(slot.subarc == noSubarc || (slot.hash == hash && GetName(slot) == name))
+        {
+            return i;
+        }
+    }
+}
+
+void file_index::Rehash(std::size_t capacity)
+{
+    ASSERT(capacity != 0 && (capacity & (capacity - 1)) == 0);
+    ASSERT(capacity >= count * 2);
+    ASSERT(slots == nullptr || slots == storage.data());
+
+    std::vector<entry> old(capacity, entry{0, 0, 0, noSubarc, 0});
+    swap(old, storage);
+    slots = storage.data();
+    numSlots = storage.size();
+
+    const std::size_t mask = numSlots - 1;
+    for(const entry& e : old)
+    {
+        if(e.subarc == noSubarc)
+        {
+            continue;
+        }
+
+        std::size_t i = static_cast<std::size_t>(e.hash) & mask;
+        while(storage[i].subarc != noSubarc)
+        {
+            i = (i + 1) & mask;
+        }
+        storage[i] = e;
+    }
+}
@@ -0,0 +1,24 @@
+/** @file
+ *  Implementation of file_table.hpp
+ *
+ *  @copyright 2016-2019 Palm Studios
+ */
+#include "SH3/arc/file_table.hpp"
+
+#include <algorithm>
+#include <string_view>
+
+using namespace sh3::arc;
+
+const file_record* file_table::Find(std::string_view name) const
+{
+    const file_record* match = std::lower_bound(begin(), end(), name, [this](const file_record& record, std::string_view key)
+    {
+        return GetName(record) < key;
+    });
+    if(match == end() || GetName(*match) != name)
+    {
+        return nullptr;
+    }
+    return match;
+}
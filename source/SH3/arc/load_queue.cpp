@@ -0,0 +1,204 @@
+/** @file
+ *  Implementation of load_queue.hpp
+ *
+ *  @copyright 2016-2019 Palm Studios
+ */
+#include "SH3/arc/load_queue.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "SH3/arc/mft.hpp"
+#include "SH3/system/assert.hpp"
+#include "SH3/system/log.hpp"
+
+using namespace sh3::arc;
+
+/**
+ *  A file that was asked for.
+ */
+struct load_queue::request final
+{
+    const mft*        source;   /**< The @ref mft to load the file from. */
+    priority_t        priority; /**< Priority of this request. */
+    clock::time_point deadline; /**< When the file is needed by. */
+    std::uint64_t     sequence; /**< Position in submission order. */
+    const void*       owner;    /**< Tag for @ref load_queue::Discard. */
+
+    callback             onLoaded; /**< Receives @ref res, if the request was submitted with a callback. */
+    std::promise<result> promise;  /**< Receives @ref res otherwise. */
+    result               res;      /**< The loaded file. */
+};
+
+namespace {
+    /**
+     *  Heap ordering for pending requests.
+     *
+     *  @returns @c true if @p a is to be served after @p b.
+     */
+    template<typename request_ptr>
+    bool ServedAfter(const request_ptr& a, const request_ptr& b)
+    {
+        if(a->priority != b->priority)
+        {
+            return a->priority < b->priority;
+        }
+        if(a->deadline != b->deadline)
+        {
+            return a->deadline > b->deadline;
+        }
+        return a->sequence > b->sequence;
+    }
+}
+
+load_queue::load_queue(std::size_t numWorkers)
+{
+    ASSERT(numWorkers > 0);
+    workers.reserve(numWorkers);
+    for(std::size_t i = 0; i < numWorkers; ++i)
+    {
+        workers.emplace_back(&load_queue::Work, this);
+    }
+}
+
+load_queue::~load_queue()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stop = true;
+        pending.clear();
+    }
+    wake.notify_all();
+
+    for(std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+std::future<load_queue::result> load_queue::Submit(const mft& source, const std::string& filename, priority_t priority, clock::time_point deadline, const void* owner)
+{
+    auto req = std::make_unique<request>();
+    req->source = &source;
+    req->priority = priority;
+    req->deadline = deadline;
+    req->owner = owner;
+    req->res.filename = filename;
+
+    std::future<result> future = req->promise.get_future();
+    Push(std::move(req));
+    return future;
+}
+
+void load_queue::Submit(const mft& source, const std::string& filename, callback onLoaded, priority_t priority, clock::time_point deadline, const void* owner)
+{
+    ASSERT(onLoaded);
+
+    auto req = std::make_unique<request>();
+    req->source = &source;
+    req->priority = priority;
+    req->deadline = deadline;
+    req->owner = owner;
+    req->onLoaded = std::move(onLoaded);
+    req->res.filename = filename;
+
+    Push(std::move(req));
+}
+
+void load_queue::Push(std::unique_ptr<request> req)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        req->sequence = sequence++;
+        pending.push_back(std::move(req));
+        std::push_heap(begin(pending), end(pending), ServedAfter<std::unique_ptr<request>>);
+    }
+    wake.notify_one();
+}
+
+std::size_t load_queue::Poll()
+{
+    std::size_t numRun = 0;
+
+    std::unique_lock<std::mutex> guard(lock);
+    // Only run what is ready now, so that workers completing in the meantime can't keep us here.
+    for(std::size_t numReady = completed.size(); numReady > 0 && !completed.empty(); --numReady)
+    {
+        std::unique_ptr<request> req = std::move(completed.front());
+        completed.pop_front();
+
+        // A callback may submit or discard requests itself, so don't hold the lock while it runs.
+        guard.unlock();
+        req->onLoaded(req->res);
+        ++numRun;
+        guard.lock();
+    }
+
+    return numRun;
+}
+
+void load_queue::Discard(const void* owner)
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    const auto isOwned = [owner](const std::unique_ptr<request>& req) { return req->owner == owner; };
+    pending.erase(std::remove_if(begin(pending), end(pending), isOwned), end(pending));
+    std::make_heap(begin(pending), end(pending), ServedAfter<std::unique_ptr<request>>);
+    completed.erase(std::remove_if(begin(completed), end(completed), isOwned), end(completed));
+
+    finished.wait(guard, [this, owner]
+    {
+        return std::none_of(begin(active), end(active), [owner](const request* req) { return req->owner == owner; });
+    });
+}
+
+void load_queue::Work()
+{
+    while(true)
+    {
+        std::unique_ptr<request> req;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this] { return stop || !pending.empty(); });
+            if(stop)
+            {
+                return;
+            }
+
+            std::pop_heap(begin(pending), end(pending), ServedAfter<std::unique_ptr<request>>);
+            req = std::move(pending.back());
+            pending.pop_back();
+            active.push_back(req.get());
+        }
+
+        req->source->LoadFile(req->res.filename, req->res.data, req->res.error);
+
+        const clock::time_point now = clock::now();
+        if(now > req->deadline)
+        {
+            const auto late = std::chrono::duration_cast<std::chrono::milliseconds>(now - req->deadline);
+            Log(LogLevel::WARN, "load_queue: %s was loaded %lld ms after its deadline", req->res.filename.c_str(), static_cast<long long>(late.count()));
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            active.erase(std::find(begin(active), end(active), req.get()));
+            if(req->onLoaded)
+            {
+                completed.push_back(std::move(req));
+            }
+            else
+            {
+                req->promise.set_value(std::move(req->res));
+            }
+        }
+        finished.notify_all();
+    }
+}
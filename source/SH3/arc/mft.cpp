@@ -5,21 +5,28 @@
  */
 #include "SH3/arc/mft.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <iterator>
 #include <limits>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
 #include <zlib.h>
 
+#include "SH3/arc/file_index.hpp"
+#include "SH3/arc/file_table.hpp"
+#include "SH3/arc/mft_cache.hpp"
 #include "SH3/arc/subarc.hpp"
+#include "SH3/common/parallel.hpp"
 #include "SH3/error.hpp"
 #include "SH3/system/log.hpp"
 
@@ -51,14 +58,27 @@ namespace {
                && std::numeric_limits<decltype(std::declval<subarc_file_info>().arcIndex)>::max() <= std::numeric_limits<subarc::index_t>::max(),
                   "index_t must be able to represent arcIndex");
 
-    /** Actual file entry */
-    struct subarc_file_entry final
+    /** @} */
+
+    /**
+     *  Where a subarc is described in the decompressed @c arc.arc.
+     */
+    struct subarc_extent final
     {
-        subarc_file_info header; /**< File info header */
-        std::string      fname;  /**< File path and name (plus ext and @c NUL terminator) */
+        std::size_t offset;   /**< Offset of the @ref subarc_header. */
+        std::size_t size;     /**< Size of the header and all file entries. */
+        std::size_t numFiles; /**< Number of file entries. */
     };
 
-    /** @} */
+    /**
+     *  A subarc read from @c arc.arc, with its own string arena.
+     */
+    struct parsed_subarc final
+    {
+        std::string              name;    /**< Name of the subarc. */
+        std::string              arena;   /**< Paths of the files of this subarc. */
+        std::vector<file_record> records; /**< The files, sorted by path. Offsets are relative to @ref arena. */
+    };
 
     /**
      *  A struct to read data from the @c arc.arc.
@@ -150,14 +170,31 @@ namespace {
          */
         bool IsOpen() const {return static_cast<bool>(gzHandle);}
 
+        /**
+         *  Find where each subarc is described in @ref contents.
+         *
+         *  This only follows the size fields of the headers, so it is quick.
+         *
+         *  @returns The @ref subarc_extent of each subarc, in order.
+         */
+        std::vector<subarc_extent> FindSubarcs() const;
+
         /**
          *  Read a @ref sh3::arc::subarc.
+         *
+         *  This does not change the @ref mft_reader, so subarcs can be read on several threads at once.
+         *
+         *  @param extent Where the subarc is, from @ref FindSubarcs.
+         *
+         *  @returns The subarc, with its files sorted by path as required by @ref file_table.
          */
         //TODO: struct subarc_read_error
-        subarc ReadNextSubarc();
+        parsed_subarc ReadSubarc(const subarc_extent& extent) const;
 
         std::size_t GetSubarcCount() const { return data.subarcCount; }
 
+        std::size_t GetFileCount() const { return data.fileCount; }
+
     private:
         /**
          *  Read binary data from an arc file to a buffer.
@@ -169,7 +206,6 @@ namespace {
          *  @returns The number of bytes read.
          *  
          *  @see @ref ReadObject
-         *  @see @ref ReadString
          */
         std::size_t ReadData(void* destination, std::size_t len, read_error& e);
 
@@ -188,7 +224,6 @@ namespace {
          *  
          *  @see @ref ReadObject(T& destination, read_error& e)
          *  @see @ref ReadData
-         *  @see @ref ReadString
          */
         template<typename T, typename = std::enable_if<std::is_trivially_copyable<T>::value>>
         size_t ReadObject(T& destination, std::size_t len, read_error& e)
@@ -210,7 +245,6 @@ namespace {
          *  
          *  @see @ref ReadObject(T& destination, std::size_t len, read_error& e)
          *  @see @ref ReadData
-         *  @see @ref ReadString
          */
         template<typename T, typename = std::enable_if<std::is_trivially_copyable<T>::value>>
         size_t ReadObject(T& destination, read_error& e)
@@ -219,22 +253,14 @@ namespace {
         }
 
         /**
-         *  Read a string from an arc file.
-         *  
-         *  @param[out] destination The string to read into.
-         *  @param      len         The number of characters to read.
-         *  @param[out] e           The @ref read_error, which is set if any error occurs.
-         *  
-         *  @returns The number of bytes read.
-         *  
-         *  @see @ref ReadObject
-         *  @see @ref ReadString
+         *  Decompress the rest of the @c arc.arc into @ref contents.
          */
-        std::size_t ReadString(std::string& destination, std::size_t len, read_error& e);
+        void ReadContents();
 
         std::unique_ptr<gzFile_s, gz_file_closer> gzHandle;
         header header;
         data data;
+        std::vector<std::uint8_t> contents; /**< The decompressed @c arc.arc after @ref data. */
     };
 
     void mft_reader::read_error::set_error(read_result res, gzFile file)
@@ -283,6 +309,7 @@ namespace {
     }
 
     static constexpr const char* mftPath = "data/arc.arc";
+    static constexpr const char* cachePath = "data/arc.idx"; /**< Where the @ref mft_cache of @ref mftPath is kept. */
 
     mft_reader::mft_reader()
         :gzHandle(gzopen(mftPath, "rb"))
@@ -312,6 +339,8 @@ namespace {
         {
             die("E00004: mft_reader::mft_reader( ): Invalid read of arc.arc information: %s!", readError.message().c_str());
         }
+
+        ReadContents();
     }
 
     std::size_t mft_reader::ReadData(void* destination, std::size_t len, read_error& e)
@@ -345,74 +374,130 @@ namespace {
         return static_cast<std::size_t>(res);
     }
 
-    std::size_t mft_reader::ReadString(std::string& destination, std::size_t len, read_error& e)
+    void mft_reader::ReadContents()
     {
-        assert(len <= std::numeric_limits<int>::max()); // overflow check
+        static constexpr std::size_t chunkSize = 256 * 1024;
+
+        read_error readError;
+        std::size_t numRead;
+        do
+        {
+            const std::size_t offset = contents.size();
+            contents.resize(offset + chunkSize);
+            numRead = ReadData(contents.data() + offset, chunkSize, readError);
+            contents.resize(offset + numRead);
+            if(readError.get_result() == read_result::GZ_ERROR)
+            {
+                die("E00005: mft_reader::ReadContents( ): Error decompressing arc.arc: %s!", readError.message().c_str());
+            }
+        } while(numRead == chunkSize);
+    }
 
-        std::vector<char> buf(len);
-        std::size_t res = ReadData(buf.data(), buf.size(), e);
-        assert(res <= buf.size());
+    std::vector<subarc_extent> mft_reader::FindSubarcs() const
+    {
+        std::vector<subarc_extent> extents;
+        extents.reserve(data.subarcCount);
 
-        auto from = begin(buf);
-        auto to = from;
-        advance(to, res);
-        destination.assign(from, to);
-        assert(destination.size() == res);
+        std::size_t offset = 0;
+        for(std::size_t i = 0; i < data.subarcCount; ++i)
+        {
+            subarc_header sub_header;
+            if(contents.size() - offset < sizeof(sub_header))
+            {
+                die("E00006: mft_reader::FindSubarcs( ): Invalid read of arc.arc subarc: End of file!");
+            }
+            std::memcpy(&sub_header, contents.data() + offset, sizeof(sub_header));
+            if(sub_header.hsize < sizeof(sub_header) || contents.size() - offset < sub_header.hsize)
+            {
+                die("E00010: mft_reader::FindSubarcs( ): Garbage read when reading subarc header (size %u)!", sub_header.hsize);
+            }
 
-        return res;
+            std::size_t size = sub_header.hsize;
+            for(std::size_t j = 0; j < sub_header.numFiles; ++j)
+            {
+                subarc_file_info info;
+                if(contents.size() - offset - size < sizeof(info))
+                {
+                    die("E00011: mft_reader::FindSubarcs( ): Invalid read of arc.arc file entry: End of file!");
+                }
+                std::memcpy(&info, contents.data() + offset + size, sizeof(info));
+                if(info.fileSize <= sizeof(info) || contents.size() - offset - size < info.fileSize)
+                {
+                    die("E00012: mft_reader::FindSubarcs( ): Garbage read when reading file entry (size %u)!", info.fileSize);
+                }
+                size += info.fileSize;
+            }
+
+            extents.push_back({offset, size, sub_header.numFiles});
+            offset += size;
+        }
+        return extents;
     }
 
-    subarc mft_reader::ReadNextSubarc()
+    parsed_subarc mft_reader::ReadSubarc(const subarc_extent& extent) const
     {
-        assert(IsOpen());
-
-        read_error readError;
+        // FindSubarcs() has already checked all the sizes
+        const std::uint8_t* const base = contents.data() + extent.offset;
 
         subarc_header sub_header;
-        ReadObject(sub_header, readError);
-        if(readError)
-        {
-            die("E00006: mft_reader::ReadNextSubarc( ): Invalid read of arc.arc subarc: %s!", readError.message().c_str());
-        }
+        std::memcpy(&sub_header, base, sizeof(sub_header));
 
-        std::string subarcName;
-        ReadString(subarcName, sub_header.hsize - sizeof(sub_header), readError);
-        if(subarcName.back() != '\0')
+        parsed_subarc sub;
+        sub.name.assign(reinterpret_cast<const char*>(base) + sizeof(sub_header), sub_header.hsize - sizeof(sub_header));
+        if(sub.name.empty() || sub.name.back() != '\0')
         {
-            die("E00007: mft_reader::ReadNextSubarc( ): Garbage read when reading subarc name (NUL terminator missing): %s!", subarcName.c_str());
+            die("E00007: mft_reader::ReadSubarc( ): Garbage read when reading subarc name (NUL terminator missing): %s!", sub.name.c_str());
         }
         // remove trailing NUL
         // Some filenames seem to have multiple NULs.
-        subarcName.resize(subarcName.find_last_not_of('\0') + 1);
-        subarcName.shrink_to_fit();
+        sub.name.resize(sub.name.find_last_not_of('\0') + 1);
 
         // We have now loaded information about the subarc, so we can start
         // reading in all the files located in it (not in full, obviously...)
-        subarc::files_map fileList;
-        for(std::size_t i = 0; i < sub_header.numFiles; ++i)
+        sub.records.reserve(extent.numFiles);
+        std::size_t offset = sub_header.hsize;
+        for(std::size_t i = 0; i < extent.numFiles; ++i)
         {
-            subarc_file_entry file;
-            ReadObject(file.header, readError);
+            subarc_file_info info;
+            std::memcpy(&info, base + offset, sizeof(info));
 
-            ReadString(file.fname, file.header.fileSize - sizeof(file.header), readError);
-            if(file.fname.back() != '\0')
+            std::string_view fname(reinterpret_cast<const char*>(base) + offset + sizeof(info), info.fileSize - sizeof(info));
+            offset += info.fileSize;
+            if(fname.back() != '\0')
             {
-                die("E00008: mft_reader::ReadNextSubarc( ): Garbage read when reading file name (NUL terminator missing): %s!", file.fname.c_str());
+                die("E00008: mft_reader::ReadSubarc( ): Garbage read when reading file name (NUL terminator missing): %s!", std::string(fname).c_str());
             }
             // remove trailing NUL
             // Some filenames seem to have multiple NULs.
-            while(file.fname.back() == '\0')
+            while(!fname.empty() && fname.back() == '\0')
             {
-                file.fname.pop_back();
+                fname.remove_suffix(1);
             }
-            file.fname.shrink_to_fit();
-            //Log(LogLevel::INFO, "Read file: %s", file.fname.c_str());
 
-            fileList[file.fname] = file.header.arcIndex; // Map the file name to its subarc index
-            //Log(LogLevel::INFO, "Added file to file list!");
+            if(fname.size() > std::numeric_limits<decltype(file_record::nameLength)>::max()
+            || sub.arena.size() > std::numeric_limits<decltype(file_record::name)>::max() - fname.size())
+            {
+                die("E00009: mft_reader::ReadSubarc( ): File name too long: %s!", std::string(fname).c_str());
+            }
+            sub.records.push_back({static_cast<std::uint32_t>(sub.arena.size()), static_cast<std::uint16_t>(fname.size()), info.arcIndex});
+            sub.arena += fname;
         }
 
-        return subarc(std::move(subarcName), std::move(fileList));
+        // Sort the files by path. If a path occurs more than once, the last entry is used.
+        const auto nameOf = [&sub](const file_record& record) { return std::string_view(sub.arena).substr(record.name, record.nameLength); };
+        std::stable_sort(begin(sub.records), end(sub.records), [&nameOf](const file_record& a, const file_record& b) { return nameOf(a) < nameOf(b); });
+        auto kept = begin(sub.records);
+        for(auto it = begin(sub.records); it != end(sub.records); ++it)
+        {
+            if(next(it) != end(sub.records) && nameOf(*next(it)) == nameOf(*it))
+            {
+                continue;
+            }
+            *kept++ = *it;
+        }
+        sub.records.erase(kept, end(sub.records));
+
+        return sub;
     }
 }
 
@@ -436,40 +521,209 @@ std::string mft::load_error::message() const
 
 mft::mft()
 {
+    // Parsing arc.arc means decompressing it and reading it entry by entry, so use the cache if it is up to date.
+    mft_cache::digest digest;
+    const bool haveDigest = mft_cache::ComputeDigest(mftPath, digest);
+    if(haveDigest && cache.Open(cachePath, digest))
+    {
+        LoadCache();
+        return;
+    }
+    cache = mft_cache();
+
     mft_reader reader;
 
-    // Load each sub-arc
-    std::size_t numSubarcs = reader.GetSubarcCount();
+    // Find all sub-arcs first, then parse them in parallel
+    const std::vector<subarc_extent> extents = reader.FindSubarcs();
+    const std::size_t numSubarcs = extents.size();
+    ASSERT(numSubarcs < file_index::noSubarc);
+    std::vector<parsed_subarc> parsed(numSubarcs);
+    sh3::ParallelFor(numSubarcs, [&](std::size_t i) { parsed[i] = reader.ReadSubarc(extents[i]); });
+
+    // Join the arenas. The file tables can only be created once the arena and records have stopped growing.
+    std::size_t arenaSize = 0;
+    std::size_t numRecords = 0;
+    for(const parsed_subarc& sub : parsed)
+    {
+        arenaSize += sub.arena.size();
+        numRecords += sub.records.size();
+    }
+    if(arenaSize > std::numeric_limits<decltype(file_record::name)>::max())
+    {
+        die("E00013: mft::mft( ): File names too long!");
+    }
+    arena.reserve(arenaSize);
+    records.reserve(numRecords);
+    std::vector<std::size_t> firstRecords;
+    firstRecords.reserve(numSubarcs);
+    for(const parsed_subarc& sub : parsed)
+    {
+        const auto base = static_cast<std::uint32_t>(arena.size());
+        firstRecords.push_back(records.size());
+        arena += sub.arena;
+        for(file_record record : sub.records)
+        {
+            record.name += base;
+            records.push_back(record);
+        }
+    }
+
     subarcs.reserve(numSubarcs);
+    index = file_index(arena.data());
+    index.Reserve(numRecords);
+    for(std::size_t i = 0; i < numSubarcs; ++i)
+    {
+        AddSubarc(std::move(parsed[i].name), file_table(arena.data(), records.data() + firstRecords[i], parsed[i].records.size()));
+    }
+
+    if(haveDigest)
+    {
+        mft_cache::Write(cachePath, digest, subarcs);
+    }
+}
 
+void mft::LoadCache()
+{
+    const std::size_t numSubarcs = cache.GetSubarcCount();
+    subarcs.reserve(numSubarcs);
     for(std::size_t i = 0; i < numSubarcs; ++i)
     {
-        subarcs.emplace_back(reader.ReadNextSubarc());
+        const mft_cache::subarc_record& record = cache.GetSubarc(i);
+        subarcs.emplace_back(std::string(cache.GetString(record.name, record.nameLength)), cache.GetFileTable(record));
+    }
+
+    // The slots were stored along with the files, so nothing has to be hashed
+    index = cache.GetIndex();
+}
+
+void mft::AddSubarc(std::string&& name, file_table files)
+{
+    const auto subarcId = static_cast<file_index::subarc_id>(subarcs.size());
+    for(const file_record& file : files)
+    {
+        index.Insert(file, subarcId);
     }
+    subarcs.emplace_back(std::move(name), files);
 }
 
-std::size_t mft::LoadFile(const std::string& filename, std::vector<std::uint8_t>& buffer, std::vector<std::uint8_t>::iterator& start, load_error &e)
+void mft::LoadFiles(const std::vector<std::string_view>& filenames, std::vector<std::uint8_t>& arena, std::vector<batch_result>& results) const
 {
-    for(subarc& candidate : subarcs)
+    results.assign(filenames.size(), batch_result());
+
+    // Look up all files, then sort them by subarc
+    std::vector<std::pair<const file_index::entry*, std::size_t>> found;
+    found.reserve(filenames.size());
+    for(std::size_t i = 0; i < filenames.size(); ++i)
+    {
+        if(const file_index::entry* entry = Find(filenames[i], results[i].error))
+        {
+            found.emplace_back(entry, i);
+        }
+    }
+    std::sort(begin(found), end(found), [](const auto& a, const auto& b) { return a.first->subarc < b.first->subarc; });
+
+    std::vector<subarc::batch_item> items;
+    for(auto first = begin(found); first != end(found);)
     {
-        subarc::load_error subarcError;
-        std::size_t result = candidate.LoadFile(filename, buffer, start, subarcError);
-        if(subarcError.get_result() != subarc::load_result::FILE_NOT_FOUND)
+        const subarc& candidate = subarcs[first->first->subarc];
+        const auto last = std::find_if(first, end(found), [first](const auto& f) { return f.first->subarc != first->first->subarc; });
+
+        items.clear();
+        for(auto it = first; it != last; ++it)
+        {
+            subarc::batch_item item;
+            item.index = it->first->index;
+            items.push_back(item);
+        }
+        candidate.LoadFiles(items, arena);
+
+        if(!items.empty() && items.front().error.get_result() == subarc::load_result::SUBARC_NOT_FOUND)
+        {
+            Log(LogLevel::WARN, "Couldn't open subarc-file %s\n", candidate.name.c_str());
+        }
+        for(std::size_t i = 0; i < items.size(); ++i)
         {
-            if(subarcError)
+            batch_result& result = results[first[static_cast<std::ptrdiff_t>(i)].second];
+            result.offset = items[i].offset;
+            result.size = items[i].size;
+            if(items[i].error)
             {
-                if(subarcError.get_result() == subarc::load_result::SUBARC_NOT_FOUND)
-                {
-                    //skip and see if other subarcs can be opened
-                    Log(LogLevel::WARN, "Couldn't open subarc-file %s\n", candidate.name.c_str());
-                    continue;
-                }
-                e.set_error(subarcError);
+                result.error.set_error(items[i].error);
             }
-            return result;
         }
+        first = last;
     }
+}
 
-    e.set_error(load_result::FILE_NOT_FOUND);
-    return 0;
+const mft& mft::Shared()
+{
+    // Initialisation of a local static is thread-safe.
+    static const mft instance;
+    return instance;
+}
+
+const file_index::entry* mft::Find(std::string_view filename, load_error &e) const
+{
+    const file_index::entry* entry = index.Find(filename);
+    if(!entry)
+    {
+        e.set_error(load_result::FILE_NOT_FOUND);
+    }
+    return entry;
+}
+
+const subarc* mft::FindFile(std::string_view filename, subarc::index_t& index, load_error &e) const
+{
+    const file_index::entry* entry = Find(filename, e);
+    if(!entry)
+    {
+        return nullptr;
+    }
+
+    index = entry->index;
+    return &subarcs[entry->subarc];
+}
+
+std::size_t mft::LoadFile(std::string_view filename, std::vector<std::uint8_t>& buffer, std::vector<std::uint8_t>::iterator& start, load_error &e) const
+{
+    const file_index::entry* entry = Find(filename, e);
+    if(!entry)
+    {
+        return 0;
+    }
+
+    const subarc& candidate = subarcs[entry->subarc];
+    subarc::load_error subarcError;
+    std::size_t result = candidate.LoadFile(entry->index, buffer, start, subarcError);
+    if(subarcError)
+    {
+        if(subarcError.get_result() == subarc::load_result::SUBARC_NOT_FOUND)
+        {
+            Log(LogLevel::WARN, "Couldn't open subarc-file %s\n", candidate.name.c_str());
+        }
+        e.set_error(subarcError);
+    }
+    return result;
+}
+
+std::size_t mft::MapFile(std::string_view filename, file_span& span, load_error &e) const
+{
+    const file_index::entry* entry = Find(filename, e);
+    if(!entry)
+    {
+        return 0;
+    }
+
+    const subarc& candidate = subarcs[entry->subarc];
+    subarc::load_error subarcError;
+    std::size_t result = candidate.MapFile(entry->index, span, subarcError);
+    if(subarcError)
+    {
+        if(subarcError.get_result() == subarc::load_result::SUBARC_NOT_FOUND)
+        {
+            Log(LogLevel::WARN, "Couldn't open subarc-file %s\n", candidate.name.c_str());
+        }
+        e.set_error(subarcError);
+    }
+    return result;
 }
@@ -0,0 +1,253 @@
+/** @file
+ *  Implementation of mft_cache.hpp
+ *
+ *  @copyright 2016-2019 Palm Studios
+ */
+#include "SH3/arc/mft_cache.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <zlib.h>
+
+#include "SH3/arc/subarc.hpp"
+#include "SH3/system/assert.hpp"
+#include "SH3/system/log.hpp"
+
+using namespace sh3::arc;
+
+namespace {
+    /**
+     *  Write the raw bytes of an array to @p out.
+     */
+    template<typename T>
+    void WriteArray(std::ofstream& out, const std::vector<T>& data)
+    {
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(T)));
+    }
+}
+
+bool mft_cache::ComputeDigest(const std::string& arcPath, digest& d)
+{
+    std::ifstream file(arcPath, std::ios::binary);
+    if(!file)
+    {
+        return false;
+    }
+
+    std::vector<char> chunk(64 * 1024);
+    d.size = 0;
+    d.crc = static_cast<std::uint32_t>(crc32(0, Z_NULL, 0));
+    while(file)
+    {
+        file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        const std::size_t numRead = static_cast<std::size_t>(file.gcount());
+        d.crc = static_cast<std::uint32_t>(crc32(d.crc, reinterpret_cast<const Bytef*>(chunk.data()), static_cast<uInt>(numRead)));
+        d.size += numRead;
+    }
+    return file.eof();
+}
+
+bool mft_cache::Write(const std::string& path, const digest& d, const std::vector<subarc>& subarcs)
+{
+    std::vector<subarc_record> subarcTable;
+    std::vector<file_record> fileTable;
+    std::string strings;
+
+    subarcTable.reserve(subarcs.size());
+    for(const subarc& sub : subarcs)
+    {
+        const file_table& files = sub.GetFiles();
+        subarcTable.push_back({static_cast<std::uint32_t>(strings.size()), static_cast<std::uint32_t>(sub.name.size()),
+                               static_cast<std::uint32_t>(fileTable.size()), static_cast<std::uint32_t>(files.size())});
+        strings += sub.name;
+
+        for(const file_record& file : files)
+        {
+            fileTable.push_back({static_cast<std::uint32_t>(strings.size()), file.nameLength, file.index});
+            strings += files.GetName(file);
+        }
+    }
+
+    if(strings.size() > std::numeric_limits<std::uint32_t>::max())
+    {
+        Log(LogLevel::WARN, "mft_cache::Write( ): String table too large, not writing %s", path.c_str());
+        return false;
+    }
+
+    // Index the files again, this time by their offsets in the string table of the cache
+    file_index index(strings.data());
+    index.Reserve(fileTable.size());
+    for(std::size_t i = 0; i < subarcTable.size(); ++i)
+    {
+        const subarc_record& sub = subarcTable[i];
+        for(std::size_t j = sub.firstFile; j < std::size_t{sub.firstFile} + sub.numFiles; ++j)
+        {
+            index.Insert(fileTable[j], static_cast<file_index::subarc_id>(i));
+        }
+    }
+
+    header head;
+    head.magic = header::expectedMagic;
+    head.version = header::expectedVersion;
+    head.arcSize = d.size;
+    head.arcCrc = d.crc;
+    head.numSubarcs = static_cast<std::uint32_t>(subarcTable.size());
+    head.numFiles = static_cast<std::uint32_t>(fileTable.size());
+    head.stringsSize = static_cast<std::uint32_t>(strings.size());
+    head.numSlots = static_cast<std::uint32_t>(index.GetCapacity());
+    head.numIndexed = static_cast<std::uint32_t>(index.GetSize());
+
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&head), sizeof(head));
+        WriteArray(out, subarcTable);
+        WriteArray(out, fileTable);
+        out.write(reinterpret_cast<const char*>(index.GetSlots()), static_cast<std::streamsize>(index.GetCapacity() * sizeof(file_index::entry)));
+        out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+        out.close();
+        if(!out)
+        {
+            Log(LogLevel::WARN, "mft_cache::Write( ): Unable to write %s", tmpPath.c_str());
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+
+    // rename() does not replace an existing file everywhere
+    std::remove(path.c_str());
+    if(std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        Log(LogLevel::WARN, "mft_cache::Write( ): Unable to move %s to %s", tmpPath.c_str(), path.c_str());
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool mft_cache::Open(const std::string& path, const digest& d)
+{
+    {
+        std::ifstream probe(path, std::ios::binary);
+        if(!probe)
+        {
+            return false;
+        }
+    }
+
+    try
+    {
+        boost::interprocess::file_mapping file(path.c_str(), boost::interprocess::read_only);
+        mapping = boost::interprocess::mapped_region(file, boost::interprocess::read_only);
+    }
+    catch(const std::exception& ex)
+    {
+        Log(LogLevel::WARN, "mft_cache::Open( ): Unable to map %s: %s", path.c_str(), ex.what());
+        return false;
+    }
+
+    const char* base = static_cast<const char*>(mapping.get_address());
+    const std::size_t size = mapping.get_size();
+    if(size < sizeof(header))
+    {
+        return false;
+    }
+
+    const header& head = *reinterpret_cast<const header*>(base);
+    if(head.magic != header::expectedMagic || head.version != header::expectedVersion)
+    {
+        return false;
+    }
+    if(head.arcSize != d.size || head.arcCrc != d.crc)
+    {
+        Log(LogLevel::INFO, "mft_cache::Open( ): %s is out of date", path.c_str());
+        return false;
+    }
+
+    const std::size_t subarcsSize = std::size_t{head.numSubarcs} * sizeof(subarc_record);
+    const std::size_t filesSize = std::size_t{head.numFiles} * sizeof(file_record);
+    const std::size_t slotsSize = std::size_t{head.numSlots} * sizeof(file_index::entry);
+    if(size != sizeof(header) + subarcsSize + filesSize + slotsSize + head.stringsSize)
+    {
+        Log(LogLevel::WARN, "mft_cache::Open( ): %s is truncated", path.c_str());
+        return false;
+    }
+
+    const subarc_record* subarcTable = reinterpret_cast<const subarc_record*>(base + sizeof(header));
+    const file_record* fileTable = reinterpret_cast<const file_record*>(base + sizeof(header) + subarcsSize);
+    const file_index::entry* slotTable = reinterpret_cast<const file_index::entry*>(base + sizeof(header) + subarcsSize + filesSize);
+
+    // Check every record once, so the accessors don't have to
+    for(std::size_t i = 0; i < head.numSubarcs; ++i)
+    {
+        const subarc_record& sub = subarcTable[i];
+        if(std::uint64_t{sub.name} + sub.nameLength > head.stringsSize || std::uint64_t{sub.firstFile} + sub.numFiles > head.numFiles)
+        {
+            Log(LogLevel::WARN, "mft_cache::Open( ): %s is corrupt", path.c_str());
+            return false;
+        }
+    }
+    for(std::size_t i = 0; i < head.numFiles; ++i)
+    {
+        const file_record& file = fileTable[i];
+        if(std::uint64_t{file.name} + file.nameLength > head.stringsSize)
+        {
+            Log(LogLevel::WARN, "mft_cache::Open( ): %s is corrupt", path.c_str());
+            return false;
+        }
+    }
+
+    // A lookup probes until it finds an empty slot, so there has to be one
+    std::size_t numOccupied = 0;
+    for(std::size_t i = 0; i < head.numSlots; ++i)
+    {
+        const file_index::entry& slot = slotTable[i];
+        if(slot.subarc == file_index::noSubarc)
+        {
+            continue;
+        }
+        if(slot.subarc >= head.numSubarcs || std::uint64_t{slot.name} + slot.nameLength > head.stringsSize)
+        {
+            Log(LogLevel::WARN, "mft_cache::Open( ): %s is corrupt", path.c_str());
+            return false;
+        }
+        ++numOccupied;
+    }
+    if((head.numSlots & (head.numSlots - 1)) != 0 || numOccupied != head.numIndexed || (head.numSlots != 0 && numOccupied >= head.numSlots)
+    || (head.numSlots == 0 && head.numFiles != 0))
+    {
+        Log(LogLevel::WARN, "mft_cache::Open( ): %s is corrupt", path.c_str());
+        return false;
+    }
+
+    subarcs = subarcTable;
+    files = fileTable;
+    slots = slotTable;
+    strings = base + sizeof(header) + subarcsSize + filesSize + slotsSize;
+    numSubarcs = head.numSubarcs;
+    numFiles = head.numFiles;
+    numSlots = head.numSlots;
+    numIndexed = head.numIndexed;
+    return true;
+}
+
+const mft_cache::subarc_record& mft_cache::GetSubarc(std::size_t i) const
+{
+    ASSERT(i < numSubarcs);
+    return subarcs[i];
+}
+
+std::string_view mft_cache::GetString(std::uint32_t offset, std::uint32_t length) const
+{
+    return std::string_view(strings + offset, length);
+}
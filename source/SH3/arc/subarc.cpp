@@ -1,14 +1,21 @@
 #include "SH3/arc/subarc.hpp"
 
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
 #include <iterator>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
 #include "SH3/system/assert.hpp"
 #include "SH3/system/log.hpp"
 
@@ -46,11 +53,85 @@ namespace {
 
 /** @}*/
 
-std::ifstream subarc::open(std::ios_base::openmode mode)
+struct subarc::open_file final
+{
+    std::mutex                     lock;    /**< Guards the members below, including the position of @ref stream. */
+    bool                           tried = false; /**< Whether opening the subarc-file has been attempted. */
+    load_error                     error;   /**< Outcome of opening the subarc-file. */
+    std::ifstream                  stream;  /**< The subarc-file. */
+    std::vector<subarc_file_entry> entries; /**< The file table of the subarc-file. */
+
+    bool                           mapTried = false; /**< Whether mapping the subarc-file has been attempted. */
+    boost::interprocess::mapped_region mapping; /**< Read-only mapping of the whole subarc-file. Empty if mapping failed. */
+};
+
+subarc::subarc(std::string &&subarcName, file_table fileTable)
+    : name(std::move(subarcName)), files(fileTable), file(std::make_unique<open_file>())
+{
+}
+
+subarc::subarc(subarc&&) = default;
+
+subarc::~subarc() = default;
+
+std::ifstream subarc::open(std::ios_base::openmode mode) const
 {
     const std::string path = "data/" + name + ".arc";
     return std::ifstream(path, mode);
 }
+
+std::size_t subarc::MapFile(index_t index, file_span& span, load_error &e) const
+{
+    std::lock_guard<std::mutex> lock(file->lock);
+    if(!EnsureOpen(e))
+    {
+        return 0;
+    }
+
+    if(index >= file->entries.size())
+    {
+        e.set_partial_header_read_error(load_error::header::FILE, 0);
+        return 0;
+    }
+    const subarc_file_entry& fileEntry = file->entries[index];
+
+    if(!file->mapTried)
+    {
+        file->mapTried = true;
+        try
+        {
+            namespace bip = boost::interprocess;
+            const bip::file_mapping mappedFile(("data/" + name + ".arc").c_str(), bip::read_only);
+            // The region keeps the mapping alive on its own; the file_mapping can go away.
+            bip::mapped_region(mappedFile, bip::read_only).swap(file->mapping);
+        }
+        catch(const boost::interprocess::interprocess_exception& ex)
+        {
+            Log(LogLevel::WARN, "Couldn't map subarc-file %s: %s", name.c_str(), ex.what());
+        }
+    }
+    if(!file->mapping.get_address())
+    {
+        e.set_map_error();
+        return 0;
+    }
+
+    const auto base = static_cast<const std::uint8_t*>(file->mapping.get_address());
+    const std::size_t mappedSize = file->mapping.get_size();
+    if(fileEntry.offset > mappedSize)
+    {
+        e.set_partial_read_error(fileEntry.length, 0);
+        return 0;
+    }
+
+    span.data = base + fileEntry.offset;
+    span.size = std::min<std::size_t>(fileEntry.length, mappedSize - fileEntry.offset);
+    if(span.size != fileEntry.length)
+    {
+        e.set_partial_read_error(fileEntry.length, span.size);
+    }
+    return span.size;
+}
  
 std::string subarc::load_error::message() const
 {
@@ -90,70 +171,251 @@ std::string subarc::load_error::message() const
             error = "Read " + std::to_string(readError.read) + "/" + std::to_string(size) + " bytes for " + headerName;
         }
         break;
+    case load_result::MAP_ERROR:
+        error = "Subarc could not be mapped into memory";
+        break;
     };
     return error;
 }
 
-std::size_t subarc::LoadFile(const std::string& filename, std::vector<std::uint8_t>& buffer, std::vector<std::uint8_t>::iterator& start, load_error &e)
+std::size_t subarc::LoadFile(std::string_view filename, std::vector<std::uint8_t>& buffer, std::vector<std::uint8_t>::iterator& start, load_error &e) const
 {
-    using std::next;
-
-    auto matching = files.equal_range(filename);
-    if(matching.first == matching.second)
+    const file_record* match = files.Find(filename);
+    if(!match)
     {
         e.set_file_not_found_error();
         return 0;
     }
 
-    using std::next;
-    // files.first is the std::map iterator
-    auto match = matching.first;
-    if(next(match) != matching.second)
+    return LoadFile(match->index, buffer, start, e);
+}
+
+bool subarc::EnsureOpen(load_error &e) const
+{
+    if(file->tried)
+    {
+        e = file->error;
+        return !e;
+    }
+    file->tried = true;
+
+    file->stream = open();
+    if(!file->stream)
+    {
+        file->error.set_subarc_not_found_error();
+        e = file->error;
+        return false;
+    }
+
+    // Read header to check validity
+    subarc_header header;
+    file->stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if(file->stream.gcount() != sizeof(header))
     {
-        Log(LogLevel::WARN, "Multiple files with name %s exist in subarc %s.", filename.c_str(), name.c_str());
+        ASSERT(file->stream.fail());
+        file->error.set_partial_header_read_error(load_error::header::SUBARC, static_cast<std::size_t>(file->stream.gcount()));
+        e = file->error;
+        return false;
     }
-    // match->second is the value of the entry the iterator is pointing at
-    return LoadFile(match->second, buffer, start, e);
+    if(header.magic != subarc_header::expectedMagic)
+    {
+        file->error.set_subarc_error(header.magic);
+        e = file->error;
+        return false;
+    }
+
+    // The file table directly follows the header, so read it in one go. A corrupt or truncated header could
+    // claim far more entries than there is file left; don't allocate the table before checking that.
+    static_assert(std::is_trivially_copyable<subarc_file_entry>::value, "must be deserializable through char*");
+    const std::streamoff tableStart = file->stream.tellg();
+    file->stream.seekg(0, std::ios_base::end);
+    const std::streamoff remaining = file->stream.tellg() - tableStart;
+    file->stream.seekg(tableStart, std::ios_base::beg);
+    if(!file->stream || remaining < 0 || header.numFiles > static_cast<std::uintmax_t>(remaining) / sizeof(subarc_file_entry))
+    {
+        // Like a short read below: report the bytes of the entry that was cut off
+        file->error.set_partial_header_read_error(load_error::header::FILE, remaining > 0 ? static_cast<std::size_t>(remaining) % sizeof(subarc_file_entry) : 0);
+        e = file->error;
+        return false;
+    }
+    file->entries.resize(header.numFiles);
+    const auto tableSize = static_cast<std::streamsize>(file->entries.size() * sizeof(subarc_file_entry));
+    file->stream.read(reinterpret_cast<char*>(file->entries.data()), tableSize);
+    if(file->stream.gcount() != tableSize)
+    {
+        ASSERT(file->stream.fail());
+        file->error.set_partial_header_read_error(load_error::header::FILE, static_cast<std::size_t>(file->stream.gcount()) % sizeof(subarc_file_entry));
+        file->entries.clear();
+        file->entries.shrink_to_fit();
+        e = file->error;
+        return false;
+    }
+
+    e = file->error;
+    return true;
 }
 
-std::size_t subarc::LoadFile(index_t index, std::vector<std::uint8_t>& buffer, std::vector<std::uint8_t>::iterator& start, load_error &e)
+std::size_t subarc::GetFileSize(index_t index, load_error &e) const
 {
-    std::ifstream file = open();
-    if(!file)
+    std::lock_guard<std::mutex> lock(file->lock);
+    if(!EnsureOpen(e))
     {
-        e.set_subarc_not_found_error();
         return 0;
     }
 
-    // Read the actual file from the appropriate sub arc
-    subarc_header header;
-    // Read header to check validity
-    file.read(reinterpret_cast<char*>(&header), sizeof(header));
-    if(file.gcount() != sizeof(header))
+    if(index >= file->entries.size())
     {
-        ASSERT(file.fail());
-        e.set_partial_header_read_error(load_error::header::SUBARC, static_cast<std::size_t>(file.gcount()));
+        e.set_partial_header_read_error(load_error::header::FILE, 0);
         return 0;
     }
-    if(header.magic != subarc_header::expectedMagic)
+    return file->entries[index].length;
+}
+
+std::size_t subarc::ReadFileAt(index_t index, std::size_t offset, void* destination, std::size_t len, load_error &e) const
+{
+    std::lock_guard<std::mutex> lock(file->lock);
+    if(!EnsureOpen(e))
+    {
+        return 0;
+    }
+
+    if(index >= file->entries.size())
+    {
+        e.set_partial_header_read_error(load_error::header::FILE, 0);
+        return 0;
+    }
+    const subarc_file_entry& fileEntry = file->entries[index];
+    if(offset >= fileEntry.length)
+    {
+        return 0;
+    }
+    len = std::min<std::size_t>(len, fileEntry.length - offset);
+
+    std::ifstream& stream = file->stream;
+    stream.seekg(static_cast<std::streamoff>(fileEntry.offset + offset));
+    stream.read(static_cast<char*>(destination), static_cast<std::streamsize>(len));
+    const auto read = static_cast<std::size_t>(stream.gcount());
+    if(read != len)
+    {
+        ASSERT(stream.fail());
+        e.set_partial_read_error(len, read);
+        // the stream is reused for the next load, so don't leave it in a failed state
+        stream.clear();
+    }
+    return read;
+}
+
+void subarc::LoadFiles(std::vector<batch_item>& items, std::vector<std::uint8_t>& arena) const
+{
+    static constexpr std::size_t maxGap = 64 * 1024; /**< Largest gap between two files that is read over rather than seeked over. */
+
+    /**
+     *  Files that are read with a single read.
+     */
+    struct run final
+    {
+        std::uint64_t begin;      /**< Offset of the first byte in the subarc-file. */
+        std::uint64_t end;        /**< Offset past the last byte in the subarc-file. */
+        std::size_t   firstItem;  /**< Position of the first file of this run in @c order. */
+        std::size_t   arenaBegin; /**< Position of the run in @c arena. */
+    };
+
+    std::lock_guard<std::mutex> lock(file->lock);
+    load_error e;
+    if(!EnsureOpen(e))
+    {
+        for(batch_item& item : items)
+        {
+            item.error = e;
+        }
+        return;
+    }
+
+    // Sort the files by where they are stored
+    std::vector<batch_item*> order;
+    order.reserve(items.size());
+    for(batch_item& item : items)
+    {
+        if(item.index >= file->entries.size())
+        {
+            item.error.set_partial_header_read_error(load_error::header::FILE, 0);
+            continue;
+        }
+        order.push_back(&item);
+    }
+    std::sort(begin(order), end(order), [this](const batch_item* a, const batch_item* b)
+    {
+        return file->entries[a->index].offset < file->entries[b->index].offset;
+    });
+
+    // Merge neighbouring files into runs
+    std::vector<run> runs;
+    std::size_t arenaEnd = arena.size();
+    for(std::size_t i = 0; i < order.size(); ++i)
+    {
+        const subarc_file_entry& fileEntry = file->entries[order[i]->index];
+        const std::uint64_t fileEnd = std::uint64_t{fileEntry.offset} + fileEntry.length;
+        if(!runs.empty() && fileEntry.offset <= runs.back().end + maxGap)
+        {
+            run& current = runs.back();
+            arenaEnd += static_cast<std::size_t>(std::max(current.end, fileEnd) - current.end);
+            current.end = std::max(current.end, fileEnd);
+        }
+        else
+        {
+            runs.push_back({fileEntry.offset, fileEnd, i, arenaEnd});
+            arenaEnd += fileEntry.length;
+        }
+    }
+    arena.resize(arenaEnd);
+
+    std::ifstream& stream = file->stream;
+    for(std::size_t r = 0; r < runs.size(); ++r)
+    {
+        const run& current = runs[r];
+        const std::size_t lastItem = r + 1 < runs.size() ? runs[r + 1].firstItem : order.size();
+
+        stream.seekg(static_cast<std::streamoff>(current.begin));
+        stream.read(reinterpret_cast<char*>(arena.data() + current.arenaBegin), static_cast<std::streamsize>(current.end - current.begin));
+        const auto read = static_cast<std::uint64_t>(stream.gcount());
+        if(current.begin + read != current.end)
+        {
+            ASSERT(stream.fail());
+            // the stream is reused for the next load, so don't leave it in a failed state
+            stream.clear();
+        }
+
+        for(std::size_t i = current.firstItem; i < lastItem; ++i)
+        {
+            batch_item& item = *order[i];
+            const subarc_file_entry& fileEntry = file->entries[item.index];
+            const std::uint64_t available = current.begin + read > fileEntry.offset ? current.begin + read - fileEntry.offset : 0;
+
+            item.offset = current.arenaBegin + static_cast<std::size_t>(fileEntry.offset - current.begin);
+            item.size = static_cast<std::size_t>(std::min<std::uint64_t>(fileEntry.length, available));
+            if(item.size != fileEntry.length)
+            {
+                item.error.set_partial_read_error(fileEntry.length, item.size);
+            }
+        }
+    }
+}
+
+std::size_t subarc::LoadFile(index_t index, std::vector<std::uint8_t>& buffer, std::vector<std::uint8_t>::iterator& start, load_error &e) const
+{
+    std::lock_guard<std::mutex> lock(file->lock);
+    if(!EnsureOpen(e))
     {
-        //TODO: report read magic
-        e.set_subarc_error(header.magic);
         return 0;
     }
 
-    // Seek to the file entry and read it
-    subarc_file_entry fileEntry;
-    ASSERT(index <= std::numeric_limits<std::streamoff>::max() / sizeof(fileEntry));
-    file.seekg(static_cast<std::streamoff>(index * sizeof(fileEntry)), std::ios_base::cur);
-    static_assert(std::is_trivially_copyable<decltype(fileEntry)>::value, "must be deserializable through char*");
-    file.read(reinterpret_cast<char*>(&fileEntry), sizeof(fileEntry));
-    if(file.gcount() != sizeof(fileEntry))
+    if(index >= file->entries.size())
     {
-        ASSERT(file.fail());
-        e.set_partial_header_read_error(load_error::header::FILE, static_cast<std::size_t>(file.gcount()));
+        // There is no entry for this index; reading it from the subarc-file would run off the file table.
+        e.set_partial_header_read_error(load_error::header::FILE, 0);
         return 0;
     }
+    const subarc_file_entry& fileEntry = file->entries[index];
 
     const auto prespace = distance(start, end(buffer));
     ASSERT(prespace >= 0);
@@ -164,16 +426,19 @@ std::size_t subarc::LoadFile(index_t index, std::vector<std::uint8_t>& buffer, s
         start = end(buffer) - fileEntry.length;
     }
 
-    file.seekg(fileEntry.offset);
+    std::ifstream& stream = file->stream;
+    stream.seekg(fileEntry.offset);
     static_assert(std::is_trivially_copyable<std::remove_reference<decltype(*start)>::type>::value, "must be deserializable through char*");
-    file.read(reinterpret_cast<char*>(&*start), fileEntry.length);
-    std::size_t read = static_cast<std::size_t>(file.gcount());
+    stream.read(reinterpret_cast<char*>(&*start), fileEntry.length);
+    std::size_t read = static_cast<std::size_t>(stream.gcount());
     ASSERT(read <= fileEntry.length);
     advance(start, read);
     if(read != fileEntry.length)
     {
-        ASSERT(file.fail());
+        ASSERT(stream.fail());
         e.set_partial_read_error(read, fileEntry.length);
+        // the stream is reused for the next load, so don't leave it in a failed state
+        stream.clear();
 
         //undo buffer resizing, if we did resize it before
         if(prespace < fileEntry.length)
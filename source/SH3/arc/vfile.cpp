@@ -10,10 +10,12 @@
  */
 #include "SH3/arc/vfile.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <cassert>
 #include <fstream>
 #include <limits>
+#include <utility>
 
 #include "SH3/arc/subarc.hpp"
 #include "SH3/arc/mft.hpp"
@@ -21,25 +23,54 @@
 
 using namespace sh3::arc;
 
-bool vfile::Open(mft& mft, const std::string& filename)
+vfile::vfile(std::vector<std::uint8_t>&& data, const std::string& filename)
+    : fpos(0), fsize(data.size()), fname(filename), open(true), contents(), buffer(std::move(data))
+{
+    contents = {buffer.data(), buffer.size()};
+}
+
+bool vfile::Open(const mft& mft, const std::string& filename)
 {
     if(open) return false;
 
+    fname = filename;
+    fpos = 0;
+
     /*
-        Load the file from the section it is, and set our local fsize to
+        Map the file from the section it is in, and set our local fsize to
         it (so we know how large it is without probing) though most headers contain the size of the
         full file
     */
     mft::load_error e;
-    std::size_t size = mft.LoadFile(filename, buffer, e);
+    fsize = mft.MapFile(filename, contents, e);
+    if(e && e.get_result() == mft::load_result::SUBARC_ERROR && e.get_subarc_error().get_result() == subarc::load_result::MAP_ERROR)
+    {
+        // Mapping is not possible, so read the file piece by piece instead.
+        e = mft::load_error();
+        contents = {};
+        source = mft.FindFile(filename, index, e);
+        if(source)
+        {
+            subarc::load_error subarcError;
+            fsize = source->GetFileSize(index, subarcError);
+            if(subarcError)
+            {
+                e.set_error(subarcError);
+            }
+        }
+        buffer.clear();
+        windowStart = 0;
+    }
+
     if(e)
     {
+        contents = {};
+        source = nullptr;
+        fsize = 0;
         open = false;
     }
     else
     {
-        fsize = size;
-
         open = true;
     }
     return open;
@@ -76,7 +107,11 @@ void vfile::Seek(long pos, std::ios_base::seekdir origin)
         static_assert(std::is_unsigned<decltype(fpos)>::value, "fpos might overflow, so it needs to be unsigned for the following operation.");
         fpos += static_cast<decltype(fpos)>(pos);
     }
-    //FIXME: std::ios_base::end
+    else if(origin == std::ios_base::end)
+    {
+        // Same as above; pos is usually negative.
+        fpos = fsize + static_cast<decltype(fpos)>(pos);
+    }
 
     // Log if there is an attempt at something naughty
     if(fpos > fsize)
@@ -86,9 +121,9 @@ void vfile::Seek(long pos, std::ios_base::seekdir origin)
     }
 }
 
-std::size_t vfile::ReadData(void* destination, std::size_t len, read_error& e)
+std::size_t vfile::Advance(std::size_t len, read_error& e)
 {
-    if(len >= buffer.size())
+    if(len >= fsize)
     {
         e.set_error(load_result::END_OF_FILE);
     }
@@ -101,16 +136,78 @@ std::size_t vfile::ReadData(void* destination, std::size_t len, read_error& e)
         e.set_error(load_result::PARTIAL_READ);
     }
 
-    std::memcpy(destination, buffer.data() + fpos, nbytes);
-
     fpos += nbytes; // Increment the position we are at in this file
 
     return nbytes;
 }
 
+const std::uint8_t* vfile::Access(std::size_t start, std::size_t& len, read_error& e)
+{
+    if(!source)
+    {
+        return contents.data + start;
+    }
+
+    if(start < windowStart || start + len > windowStart + buffer.size())
+    {
+        // Refill the window, starting at the requested position since files are mostly read front to back.
+        subarc::load_error subarcError;
+        buffer.resize(std::min(std::max(len, windowSize), fsize - start));
+        buffer.resize(source->ReadFileAt(index, start, buffer.data(), buffer.size(), subarcError));
+        windowStart = start;
+        if(subarcError)
+        {
+            Log(LogLevel::WARN, "sh3_arc_vfile::Access( ): Unable to read %s: %s", fname.c_str(), subarcError.message().c_str());
+        }
+    }
+
+    const std::size_t available = std::min(len, windowStart + buffer.size() - start);
+    if(available != len)
+    {
+        e.set_error(load_result::PARTIAL_READ);
+        len = available;
+    }
+    return buffer.data() + (start - windowStart);
+}
+
+std::size_t vfile::ReadData(void* destination, std::size_t len, read_error& e)
+{
+    const std::size_t start = fpos;
+    std::size_t nbytes = Advance(len, e);
+
+    if(source && nbytes > windowSize)
+    {
+        // Too large for the window, so don't bother going through it
+        subarc::load_error subarcError;
+        const std::size_t read = source->ReadFileAt(index, start, destination, nbytes, subarcError);
+        if(read != nbytes)
+        {
+            e.set_error(load_result::PARTIAL_READ);
+            nbytes = read;
+        }
+    }
+    else if(nbytes > 0)
+    {
+        std::memcpy(destination, Access(start, nbytes, e), nbytes);
+    }
+
+    fpos = start + nbytes;
+    return nbytes;
+}
+
+file_span vfile::ReadSpan(std::size_t len, read_error& e)
+{
+    const std::size_t start = fpos;
+    std::size_t nbytes = Advance(len, e);
+
+    const std::uint8_t* data = Access(start, nbytes, e);
+    fpos = start + nbytes;
+    return {data, nbytes};
+}
+
 void vfile::Dump2Disk() const
 {
-    if(!open || buffer.empty())
+    if(!open || fsize == 0)
     {
         Log(LogLevel::WARN, "sh3_arc_vfile::Dump2Disk( ): Warning! Attempting to flush unopen or empty buffer to disk!");
         return;
@@ -123,6 +220,16 @@ void vfile::Dump2Disk() const
     if(!out_file)
         return;
 
-    assert(buffer.size() <= std::numeric_limits<std::streamsize>::max());
-    out_file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    file_span data = contents;
+    std::vector<std::uint8_t> streamed;
+    if(source)
+    {
+        subarc::load_error e;
+        streamed.resize(fsize);
+        streamed.resize(source->ReadFileAt(index, 0, streamed.data(), streamed.size(), e));
+        data = {streamed.data(), streamed.size()};
+    }
+
+    assert(data.size <= std::numeric_limits<std::streamsize>::max());
+    out_file.write(reinterpret_cast<const char*>(data.data), static_cast<std::streamsize>(data.size));
 }
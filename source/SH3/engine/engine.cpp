@@ -11,6 +11,9 @@
  *  @author Jesse Buhagiar [quaker762]
  */
 #include "SH3/engine/engine.hpp"
+#include "SH3/arc/load_queue.hpp"
+#include "SH3/graphics/texture_manager.hpp"
+#include "SH3/graphics/texture_upload.hpp"
 #include "SH3/graphics/msbmp.hpp"
 #include "SH3/engine/state/intro.hpp"
 
@@ -29,7 +32,9 @@ CEngine::CEngine()
 
 CEngine::~CEngine()
 {
-
+    // hwnd (and with it the GL context) is destroyed right after this, while the singletons live on until exit
+    sh3::graphics::CTextureManager::Instance().Clear();
+    sh3::graphics::CTextureUploader::Instance().Shutdown();
 }
 
 void CEngine::Init(const std::string& args)
@@ -79,6 +84,10 @@ void CEngine::Run(void) noexcept
                 running = false;
         }
 
+        // Hand finished background loads to whoever asked for them
+        sh3::arc::load_queue::Instance().Poll();
+        sh3::graphics::CTextureUploader::Instance().Poll();
+
         stateManager.Peek().get()->InputHandler(event);
         stateManager.Peek().get()->Update();
         stateManager.Peek().get()->Render();
@@ -9,29 +9,41 @@
  */
 #include "SH3/engine/gamestate.hpp"
 #include "SH3/engine/state/intro.hpp"
+#include "SH3/system/glvertexlayout.hpp"
+#include "SH3/system/log.hpp"
+#include "SH3/types/vertex.hpp"
+
+#include <chrono>
+#include <cstddef>
 
 using namespace sh3::state;
 
-// Quad Co-Ordinates
-static GLfloat vert_buffer[] =
+namespace
+{
+/**
+ *  Vertex of the quad the logos are drawn on.
+ */
+struct quad_vertex
 {
-    -1.0f, 1.0f, 0.0f,
-    -1.0f, -1.0f, 0.0f,
-    1.0f, -1.0f, 0.0f,
-    1.0f, -1.0f, 0.0f,
-    1.0f, 1.0f, 0.0f,
-    -1.0f, 1.0f, 0.0f,
+    vertex3f position;  /**< Position */
+    texcoord uv;        /**< Texture UV Co-Ordinate */
 };
 
-static GLfloat uv_buffer[] =
+using quad_layout = sh3::gl::vertex_layout<quad_vertex,
+                                           sh3::gl::vertex_attrib<0, vertex3f, offsetof(quad_vertex, position)>,
+                                           sh3::gl::vertex_attrib<1, texcoord, offsetof(quad_vertex, uv)>>;
+
+// Quad Co-Ordinates
+const quad_vertex quad[] =
 {
-    0.0f, 0.0f,
-    0.0f, 1.0f,
-    1.0f, 1.0f,
-    1.0f, 1.0f,
-    1.0f, 0.0f,
-    0.0f, 0.0f,
+    {{-1.0f, 1.0f, 0.0f},   {0.0f, 0.0f}},
+    {{-1.0f, -1.0f, 0.0f},  {0.0f, 1.0f}},
+    {{1.0f, -1.0f, 0.0f},   {1.0f, 1.0f}},
+    {{1.0f, -1.0f, 0.0f},   {1.0f, 1.0f}},
+    {{1.0f, 1.0f, 0.0f},    {1.0f, 0.0f}},
+    {{-1.0f, 1.0f, 0.0f},   {0.0f, 0.0f}},
 };
+}
 
 
 void CIntroState::Init(void) noexcept
@@ -48,24 +60,25 @@ void CIntroState::Init(void) noexcept
     // Load textures
     kcet.Load("data/pic/kcet.bmp");
     konami1.Load("data/pic/konami.bmp");
-    warning.Load(mft, "data/pic/sy/sys_warning.tex");
+
+    // The warning is only shown after both logos, so it can be loaded while they are on screen.
+    LoadAsync("data/pic/sy/sys_warning.tex", [this](sh3::arc::load_queue::result& res)
+    {
+        if(res.error)
+        {
+            Log(LogLevel::WARN, "CIntroState::Init( ): Unable to load %s: %s", res.filename.c_str(), res.error.message().c_str());
+            return;
+        }
+
+        // Decoded through the texture cache, like textures loaded straight from the mft
+        sh3::arc::vfile file(std::move(res.data), res.filename);
+        warning.Load(mft, res.filename, file);
+    }, sh3::arc::load_queue::PRIORITY_NORMAL, sh3::arc::load_queue::clock::now() + std::chrono::seconds(10));
 
     // Upload geometry data to the GPU
-    vertBuff.BufferData(sh3::gl::CVertexBuffer::BufferTarget::ARRAY_BUFFER, sizeof(vert_buffer), vert_buffer, sh3::gl::CVertexBuffer::BufferUsage::STATIC_DRAW);
-    vertAttribs.idx = 0;
-    vertAttribs.normalize = false;
-    vertAttribs.offset = 0;
-    vertAttribs.size = 3;
-    vertAttribs.stride = 0;
-    quadVao2.BindAttribute(vertAttribs, vertBuff, sh3::gl::VertexAttribute::AttributeType::FLOAT);
-
-    uvBuff.BufferData(sh3::gl::CVertexBuffer::BufferTarget::ARRAY_BUFFER, sizeof(uv_buffer), uv_buffer, sh3::gl::CVertexBuffer::BufferUsage::STATIC_DRAW);
-    uvAttribs.idx = 1;
-    uvAttribs.normalize = false;
-    uvAttribs.offset = 0;
-    uvAttribs.size = 2;
-    uvAttribs.stride = 0;
-    quadVao2.BindAttribute(uvAttribs, uvBuff, sh3::gl::VertexAttribute::AttributeType::FLOAT);
+    quadBuff.BufferData(sizeof(quad), quad, sh3::gl::CVertexBuffer::BufferUsage::STATIC_DRAW);
+    quadVao2.SetLayout<quad_layout>();
+    quadVao2.BindVertexBuffer<quad_layout>(quadBuff);
 
     numTimes = 0;
     ticks = 0;
@@ -105,12 +118,16 @@ void CIntroState::Render(void) noexcept
     glClear(GL_COLOR_BUFFER_BIT);
     shader.Bind();
 
+    sh3::graphics::CTexture* tex;
     if(numTimes == 0)
-        konami1.Bind(GL_TEXTURE0);
+        tex = &konami1;
     else if(numTimes == 1)
-        kcet.Bind(GL_TEXTURE0);
+        tex = &kcet;
     else
-        warning.Bind(GL_TEXTURE0);
+        tex = &warning;
+
+    shader.SetUniform<GLint>("paletted", tex->IsPaletted());
+    tex->Bind(GL_TEXTURE0);
 
     quadVao2.Bind();
     glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -0,0 +1,179 @@
+/** @file
+ *
+ *  Implementation of atlas.hpp
+ *
+ *  @copyright 2016-2019  Palm Studios
+ */
+#include "SH3/graphics/atlas.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "SH3/arc/vfile.hpp"
+#include "SH3/graphics/texture.hpp"
+#include "SH3/graphics/texture_cache.hpp"
+#include "SH3/system/assert.hpp"
+#include "SH3/system/log.hpp"
+
+using namespace sh3::graphics;
+
+namespace
+{
+constexpr std::size_t border = 1; /**< Pixels around each texture, copied from its edges. */
+}
+
+CTextureAtlas::~CTextureAtlas()
+{
+    glDeleteTextures(1, &tex);
+}
+
+CTextureAtlas::handle CTextureAtlas::Add(const sh3::arc::mft& mft, const std::string& filename)
+{
+    texture_image image;
+    if(!LoadTextureImage(mft, filename, image))
+    {
+        Log(LogLevel::WARN, "CTextureAtlas::Add( ): Unable to load %s", filename.c_str());
+        entries.emplace_back();
+        return entries.size() - 1;
+    }
+    return Add(image);
+}
+
+std::vector<CTextureAtlas::handle> CTextureAtlas::AddBatch(const sh3::arc::mft& mft, const std::string& filename)
+{
+    sh3::arc::vfile file(mft, filename);
+    std::vector<texture_image> images;
+    if(!DecodeTextureBatch(file, images))
+    {
+        Log(LogLevel::WARN, "CTextureAtlas::AddBatch( ): Unable to load %s", filename.c_str());
+        return {};
+    }
+
+    std::vector<handle> handles;
+    handles.reserve(images.size());
+    for(const texture_image& image : images)
+    {
+        if(image.levels.empty())
+        {
+            entries.emplace_back();
+            handles.push_back(entries.size() - 1);
+            continue;
+        }
+        handles.push_back(Add(image));
+    }
+    return handles;
+}
+
+CTextureAtlas::handle CTextureAtlas::Add(const texture_image& image)
+{
+    ASSERT(!image.levels.empty());
+
+    entry e;
+    e.width = image.width;
+    e.height = image.height;
+    ConvertToRGBA8(image, e.pixels);
+    entries.push_back(std::move(e));
+    return entries.size() - 1;
+}
+
+bool CTextureAtlas::Build()
+{
+    // Put the textures in rows, tallest first, so little space is wasted at the bottom of each row
+    std::vector<std::size_t> order(entries.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b)
+    {
+        return entries[a].height > entries[b].height;
+    });
+
+    struct position
+    {
+        std::size_t x, y;
+    };
+    std::vector<position> positions(entries.size());
+    const auto atlasWidth = static_cast<std::size_t>(width);
+    const auto atlasHeight = static_cast<std::size_t>(height);
+    std::size_t x = 0;
+    std::size_t y = 0;
+    std::size_t rowHeight = 0;
+    for(std::size_t i : order)
+    {
+        const std::size_t cellWidth = entries[i].width + 2 * border;
+        const std::size_t cellHeight = entries[i].height + 2 * border;
+        if(x + cellWidth > atlasWidth)
+        {
+            x = 0;
+            y += rowHeight;
+            rowHeight = 0;
+        }
+        if(x + cellWidth > atlasWidth || y + cellHeight > atlasHeight)
+        {
+            Log(LogLevel::WARN, "CTextureAtlas::Build( ): %zu textures don't fit into %dx%d", entries.size(), width, height);
+            return false;
+        }
+
+        positions[i] = {x, y};
+        x += cellWidth;
+        rowHeight = std::max(rowHeight, cellHeight);
+    }
+
+    // Copy each texture (and its border) into place
+    std::vector<std::uint8_t> pixels(atlasWidth * atlasHeight * 4);
+    for(std::size_t i = 0; i < entries.size(); ++i)
+    {
+        entry& e = entries[i];
+        if(e.width == 0 || e.height == 0)
+        {
+            e.uv = region();
+            continue;
+        }
+
+        for(std::size_t row = 0; row < e.height + 2 * border; ++row)
+        {
+            const std::size_t srcRow = std::min<std::size_t>(row > border ? row - border : 0, e.height - 1u);
+            std::uint8_t* dst = &pixels[((positions[i].y + row) * atlasWidth + positions[i].x) * 4];
+            const std::uint8_t* src = &e.pixels[srcRow * e.width * 4];
+
+            std::memcpy(dst, src, 4 * border);
+            std::memcpy(dst + 4 * border, src, std::size_t{e.width} * 4);
+            std::memcpy(dst + 4 * (border + e.width), src + (e.width - 1u) * 4, 4 * border);
+        }
+
+        e.uv.u0 = static_cast<GLfloat>(positions[i].x + border) / static_cast<GLfloat>(width);
+        e.uv.v0 = static_cast<GLfloat>(positions[i].y + border) / static_cast<GLfloat>(height);
+        e.uv.u1 = static_cast<GLfloat>(positions[i].x + border + e.width) / static_cast<GLfloat>(width);
+        e.uv.v1 = static_cast<GLfloat>(positions[i].y + border + e.height) / static_cast<GLfloat>(height);
+    }
+
+    if(tex == 0)
+    {
+        glGenTextures(1, &tex);
+    }
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+const CTextureAtlas::region& CTextureAtlas::GetRegion(handle h) const
+{
+    ASSERT(h < entries.size());
+    return entries[h].uv;
+}
+
+void CTextureAtlas::Bind(GLenum textureUnit) const
+{
+    ASSERT(textureUnit >= GL_TEXTURE0 && textureUnit <= GL_TEXTURE31);
+
+    glActiveTexture(textureUnit);
+    glBindTexture(GL_TEXTURE_2D, tex);
+}
@@ -0,0 +1,167 @@
+/** @file
+ *
+ *  Implementation of palette.hpp
+ *
+ *  @copyright 2016-2019  Palm Studios
+ */
+#include "SH3/graphics/palette.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <vector>
+
+#include "SH3/system/log.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SH3_PALETTE_AVX2
+#include <immintrin.h>
+#endif
+
+using namespace sh3::graphics;
+
+namespace
+{
+/**
+ *  Expand pixels one at a time.
+ *
+ *  @returns The number of pixels written (always @p count).
+ */
+std::size_t ExpandScalar(const std::uint8_t* src, std::size_t count, const expanded_palette& palette, std::uint8_t* dst, pixel_layout layout)
+{
+    if(layout == pixel_layout::RGBA8)
+    {
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            std::memcpy(dst + i * 4, &palette[src[i]], 4);
+        }
+    }
+    else
+    {
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            const rgba& pixel = palette[src[i]];
+            dst[i * 3 + 0] = pixel.r;
+            dst[i * 3 + 1] = pixel.g;
+            dst[i * 3 + 2] = pixel.b;
+        }
+    }
+    return count;
+}
+
+#ifdef SH3_PALETTE_AVX2
+/**
+ *  Expand pixels 8 at a time, by gathering their colors from the palette.
+ *
+ *  @returns The number of pixels written. The remaining (less than 8) pixels are left to @ref ExpandScalar.
+ */
+__attribute__((target("avx2")))
+std::size_t ExpandAVX2(const std::uint8_t* src, std::size_t count, const expanded_palette& palette, std::uint8_t* dst, pixel_layout layout)
+{
+    static_assert(sizeof(rgba) == sizeof(int), "palette entries must be gathered as 32-bit integers");
+    const int* table = reinterpret_cast<const int*>(palette.data());
+
+    std::size_t i = 0;
+    if(layout == pixel_layout::RGBA8)
+    {
+        for(; i + 8 <= count; i += 8)
+        {
+            const __m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+            const __m256i pixels = _mm256_i32gather_epi32(table, indices, 4);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), pixels);
+        }
+    }
+    else
+    {
+        // Drop the alpha of the 4 pixels in each half, then move the 12 bytes left of the upper half next to the lower half
+        const __m256i dropAlpha = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                                   0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        const __m256i compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+        for(; i + 8 <= count; i += 8)
+        {
+            const __m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+            __m256i pixels = _mm256_i32gather_epi32(table, indices, 4);
+            pixels = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(pixels, dropAlpha), compact);
+
+            // 24 bytes, written without touching the pixels after them
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 3), _mm256_castsi256_si128(pixels));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i * 3 + 16), _mm256_extracti128_si256(pixels, 1));
+        }
+    }
+    return i;
+}
+
+/**
+ *  Check (once) whether this CPU can run @ref ExpandAVX2.
+ */
+bool HasAVX2()
+{
+    static const bool hasAVX2 = []
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return hasAVX2;
+}
+#endif
+}
+
+expanded_palette sh3::graphics::BuildPalette(const std::vector<rgba>& colors)
+{
+    // we need to swap some colors every 32 pixels, starting from the 8th
+    static constexpr std::size_t swapDistance = 32; // distance between swaps
+    static constexpr std::size_t swapSize = 8; // amount of colors to swap
+
+    // Work out where each color comes from, then copy them over in one go
+    std::vector<std::size_t> order(colors.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    if(order.size() > 8)
+    {
+        for(auto iter = next(begin(order), 8); static_cast<std::size_t>(distance(iter, end(order))) > swapDistance; advance(iter, swapDistance))
+        {
+            // swap 8 colors
+            const auto swapBlock = next(iter, swapSize);
+            if(static_cast<std::size_t>(distance(swapBlock, end(order))) < swapSize)
+            {
+                Log(LogLevel::WARN, "Palette doesn't have enough colors left for swapping.");
+                break;
+            }
+            std::swap_ranges(iter, swapBlock, swapBlock);
+        }
+    }
+
+    // Indices only go up to 255
+    expanded_palette palette{};
+    for(std::size_t i = 0; i < std::min(order.size(), palette.size()); ++i)
+    {
+        palette[i] = colors[order[i]];
+        palette[i].a = static_cast<std::uint8_t>(std::min(palette[i].a * 2, 0xff));
+    }
+    return palette;
+}
+
+void sh3::graphics::ExpandPalette(const std::uint8_t* src, std::size_t srcSize, const expanded_palette& palette, std::uint8_t* dst, std::size_t numPixels, pixel_layout layout)
+{
+    const std::size_t bytesPerPixel = layout == pixel_layout::RGBA8 ? 4 : 3;
+    const std::size_t numRead = std::min(srcSize, numPixels);
+
+    std::size_t done = 0;
+#ifdef SH3_PALETTE_AVX2
+    if(HasAVX2())
+    {
+        done = ExpandAVX2(src, numRead, palette, dst, layout);
+    }
+#endif
+    ExpandScalar(src + done, numRead - done, palette, dst + done * bytesPerPixel, layout);
+
+    // Missing indices are 0
+    for(std::size_t i = numRead; i < numPixels; ++i)
+    {
+        std::memcpy(dst + i * bytesPerPixel, &palette[0], bytesPerPixel);
+    }
+}
@@ -0,0 +1,131 @@
+/** @file
+ *
+ *  Implementation of swizzle.hpp
+ *
+ *  @copyright 2016-2019  Palm Studios
+ */
+#include "SH3/graphics/swizzle.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "SH3/system/assert.hpp"
+
+using namespace sh3::graphics;
+
+namespace
+{
+/**
+ *  Work out where each index of a swizzled texture goes.
+ *
+ *  This walks the texture in the order the indices are stored: 32 indices at a time, covering a 16 pixel wide
+ *  strip of two lines that are two apart.
+ *
+ *  @param width  Width of the texture.
+ *  @param height Height of the texture.
+ */
+unswizzle_table BuildUnswizzleTable(std::uint16_t width, std::uint16_t height)
+{
+    unswizzle_table table;
+    table.reserve(static_cast<std::size_t>(width) * height);
+
+    std::uint32_t x = 0;
+    std::uint32_t y = 0;
+    bool offsetFlipper = false;
+
+    // FIXME: distortion on 16-pixel wide block on the left
+    while(true)
+    {
+        for(unsigned i = 0; i < 32; ++i)
+        {
+            auto xoffset = static_cast<std::uint8_t>(((i << 2) & 0xfu) + ((i >> 2) & 0xfu));
+            if(i > 16 && i % 2u) // aka (i & 17) == 17
+            {
+                xoffset ^= 8u;
+                xoffset &= 0xfu;
+            }
+            if(offsetFlipper)
+            {
+                xoffset ^= 4u;
+            }
+
+            const std::uint32_t tempx = x + xoffset - 16;
+            // every other pixel is for (y + 2)
+            const std::uint32_t tempy = y + ((i % 2u) ? 2u : 0u);
+
+            table.push_back(width * tempy + tempx % width);
+        }
+
+        x += 16;
+        if(x < width)
+        {
+            continue;
+        }
+
+        x = 0;
+
+        ++y;
+        if(y % 2 == 0)
+        {
+            // each iteration we read two lines: offset 0 and 2
+            // so after two iterations, we have read the lines with offset 0 and 2, 1 and 3
+            // so now we need to skip two additional lines, since we read 2 and 3 already
+            y += 2;
+
+            if(y >= height)
+            {
+                break;
+            }
+
+            offsetFlipper = !offsetFlipper;
+        }
+
+        if(y == height)
+        {
+            break;
+        }
+    }
+
+    return table;
+}
+}
+
+std::shared_ptr<const unswizzle_table> sh3::graphics::GetUnswizzleTable(std::uint16_t width, std::uint16_t height)
+{
+    ASSERT(width != 0);
+
+    static std::mutex lock;
+    static std::map<std::pair<std::uint16_t, std::uint16_t>, std::shared_ptr<const unswizzle_table>> tables;
+
+    std::lock_guard<std::mutex> guard(lock);
+    std::shared_ptr<const unswizzle_table>& table = tables[std::make_pair(width, height)];
+    if(!table)
+    {
+        table = std::make_shared<const unswizzle_table>(BuildUnswizzleTable(width, height));
+    }
+    return table;
+}
+
+void sh3::graphics::Unswizzle8(const std::uint8_t* src, std::size_t srcSize, std::uint8_t* dst, std::size_t dstSize, const unswizzle_table& table)
+{
+    const std::size_t numRead = std::min(srcSize, table.size());
+    for(std::size_t i = 0; i < numRead; ++i)
+    {
+        if(table[i] < dstSize)
+        {
+            dst[table[i]] = src[i];
+        }
+    }
+    for(std::size_t i = numRead; i < table.size(); ++i)
+    {
+        if(table[i] < dstSize)
+        {
+            dst[table[i]] = 0;
+        }
+    }
+}
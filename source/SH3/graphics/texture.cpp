@@ -14,14 +14,23 @@
 #include <SH3/arc/mft.hpp>
 #include <SH3/arc/vfile.hpp>
 #include <SH3/types/color.hpp>
+#include "SH3/common/parallel.hpp"
 #include "SH3/graphics/msbmp.hpp"
+#include "SH3/graphics/palette.hpp"
+#include "SH3/graphics/swizzle.hpp"
+#include "SH3/graphics/texture_cache.hpp"
+#include "SH3/graphics/texture_upload.hpp"
 
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstring>
 #include <fstream>
 #include <functional>
 #include <limits>
+#include <memory>
+#include <string>
+#include <vector>
 
 using namespace sh3::graphics;
 
@@ -59,9 +68,10 @@ namespace
  *  @param width - The Width of this texture.
  *  @param height - The Height of this texture.
  *  @param data - Pixel data
+ *  @param size - Size of the pixel data in bytes.
  *  @param bpp - Bitness of data (not the actual texture).
  */
-void DumpRGB2Bitmap(std::uint32_t width, std::uint32_t height, std::vector<std::uint8_t>& data, std::uint8_t bpp)
+void DumpRGB2Bitmap(std::uint32_t width, std::uint32_t height, const std::uint8_t* data, std::size_t size, std::uint8_t bpp)
 {
     tga_header header;
     std::ofstream file("output.tga", std::ios::binary); // Open the stream for binary output
@@ -89,64 +99,186 @@ void DumpRGB2Bitmap(std::uint32_t width, std::uint32_t height, std::vector<std::
     }
 
     file.write(reinterpret_cast<const char*>(&header), sizeof(header));
-    assert(data.size() <= std::numeric_limits<std::streamsize>::max());
-    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    assert(size <= std::numeric_limits<std::streamsize>::max());
+    file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
 }
+
+/**
+ *  Offset of the first texture information header, i.e. the size of the batch part of @ref sh3_texture_header.
+ */
+constexpr std::size_t batchHeaderLength = offsetof(sh3_texture_header, texHeaderSegMarker);
+
+/**
+ *  Where one texture of a batch is in the texture file.
+ */
+struct batch_entry
+{
+    sh3_texture_info_header info;       /**< Information header of the texture */
+    std::size_t             pixels;     /**< Offset of the pixel data */
+    std::size_t             palette;    /**< Offset of the @ref palette_info (paletted textures only) */
+};
+
+/**
+ *  Copy a structure out of a texture file.
+ *
+ *  @returns @c false if the file is too short.
+ */
+template<typename T>
+bool ReadStruct(const sh3::arc::file_span& file, std::size_t offset, T& value)
+{
+    if(offset > file.size || file.size - offset < sizeof(T))
+    {
+        return false;
+    }
+    std::memcpy(&value, file.data + offset, sizeof(T));
+    return true;
 }
 
-//TODO: Scale the texture and then
-void CTexture::Load(sh3::arc::mft& mft, const std::string& filename)
+/**
+ *  Get the number of 256 byte blocks in a palette.
+ */
+std::size_t GetPaletteBlockCount(const palette_info& pal_header)
 {
-    sh3_texture_header          header;
-    sh3::arc::vfile             file(mft, filename);
-    sh3::arc::vfile::read_error e;
-    std::vector<std::uint8_t>   data;       // Pixel data of this texture (with the header stripped)
+    if(pal_header.entrySize == 0 || pal_header.bytes_per_pixel == 0)
+    {
+        return 0;
+    }
+    return (pal_header.paletteSize / pal_header.entrySize) / pal_header.bytes_per_pixel;
+}
 
-    std::streamsize             offset = 0;
+/**
+ *  Get pixel data that can be uploaded as-is.
+ *
+ *  @param file   The texture file.
+ *  @param offset Offset of the pixel data.
+ *  @param size   Size of the pixel data in bytes.
+ *  @param buffer Storage for the pixel data, only used if the file is too short.
+ *
+ *  @returns Pointer to @p size bytes of pixel data. This points straight into @p file if possible.
+ */
+const std::uint8_t* GetPixels(const sh3::arc::file_span& file, std::size_t offset, std::size_t size, std::vector<std::uint8_t>& buffer)
+{
+    const std::size_t available = offset < file.size ? std::min(size, file.size - offset) : 0;
+    if(available == size)
+    {
+        return file.data + offset;
+    }
 
-    std::size_t ret = file.ReadData(&header, sizeof(header), e);
+    Log(LogLevel::WARN, "sh3_texture::Load( ): Warning: Texture data is truncated (expected %zu bytes, got %zu)!", size, available);
+    buffer.assign(size, 0);
+    if(available != 0)
+    {
+        std::copy_n(file.data + offset, available, buffer.begin());
+    }
+    return buffer.data();
+}
+
+/**
+ *  Find the textures in a texture file.
+ *
+ *  Only the layout of the first texture is really known. The other textures of a batch are assumed to follow it
+ *  the same way: each one starts (with its information header) right after the pixels (or palette) of the one before.
+ *
+ *  @param file        The texture file.
+ *  @param entries     The textures are added to this.
+ *  @param maxTextures Stop after this many textures.
+ *
+ *  @returns @c true if at least the first texture was found.
+ */
+bool ParseTextureBatch(const sh3::arc::file_span& file, std::vector<batch_entry>& entries, std::size_t maxTextures)
+{
+    sh3_texture_header header;
+    std::size_t        offset = 0;
 
-    if(ret != sizeof(header))
-        die("sh3_texture::Load( ): ReadData( ) != sizeof(header)!");
+    if(!ReadStruct(file, offset, header))
+    {
+        Log(LogLevel::WARN, "sh3_texture::Load( ): Warning: File is too short for a texture header!");
+        return false;
+    }
 
     // Check for the pesky 64-byte A7A7A7A7 header that sometimes precedes our texture header
     if(header.batchHeaderMarker == 0x00000000 && header.batchSize == 0xA7A7A7A7) // AHA!
     {
         offset = 0x40; // Skip the unknown header if it exists
 
-        file.Seek(offset, std::ios_base::beg);
-        file.ReadData(&header, sizeof(header), e);
+        if(!ReadStruct(file, offset, header))
+        {
+            Log(LogLevel::WARN, "sh3_texture::Load( ): Warning: File is too short for a texture header!");
+            return false;
+        }
+    }
+
+    const std::size_t numTextures = std::min<std::size_t>(std::max<std::uint32_t>(header.numBatchedTextures, 1), maxTextures);
+    for(std::size_t i = 0; i < numTextures; ++i)
+    {
+        // Offsets in the information header are relative to the start of the batch header for the first texture,
+        // so pretend every texture has one in front of it.
+        batch_entry entry;
+        if(!ReadStruct(file, offset + batchHeaderLength, entry.info) || (i != 0 && entry.info.texHeaderMarker != 0xFFFFFFFF))
+        {
+            Log(LogLevel::WARN, "sh3_texture::Load( ): Warning: Only found %zu of %u batched textures!", i, header.numBatchedTextures);
+            break;
+        }
+
+        entry.pixels = offset + (entry.info.texFileSize - entry.info.texSize);
+        entry.palette = offset + header.batchHeaderSize + entry.info.texFileSize;
+        entries.push_back(entry);
 
-        if(ret != sizeof(header))
-            die("sh3_texture::Load( ): ReadData( ) != sizeof(header)!");
+        std::size_t end = offset + entry.info.texFileSize;
+        palette_info pal_header;
+        if(entry.info.bpp == CTexture::PixelFormat::PALETTE && ReadStruct(file, entry.palette, pal_header))
+        {
+            end = entry.palette + sizeof(pal_header) + GetPaletteBlockCount(pal_header) * 256;
+        }
+        if(end <= offset + batchHeaderLength)
+        {
+            break; // Broken header, we'd never get anywhere
+        }
+        offset = end - batchHeaderLength;
     }
 
-    if(header.texSize == static_cast<decltype(header.texSize)>(header.texWidth * header.texHeight) * 4u)
+    return !entries.empty();
+}
+
+/**
+ *  Decode one texture of a texture file.
+ *
+ *  This only reads from @p file, so several textures of a batch can be decoded at once.
+ *
+ *  @param file  The texture file.
+ *  @param entry Where the texture is in @p file.
+ *  @param image Set to the decoded texture. Its level 0 might point into @p file.
+ *
+ *  @returns @c true on success, @c false if the texture is broken.
+ */
+bool DecodeBatchEntry(const sh3::arc::file_span& file, const batch_entry& entry, texture_image& image)
+{
+    sh3_texture_info_header     header = entry.info;
+    const std::uint8_t*         pixels;     // Pixel data of level 0. Points either into image.storage or straight into the file
+
+    if(header.texSize == static_cast<decltype(header.texSize)>(header.width * header.height) * 4u)
     {
         header.bpp = 32; // Thanks KONAMI!
     }
 
     // Now that we're done that, we can check perform some sanity checks on our texture!
-    if(header.texSize != static_cast<decltype(header.texSize)>(header.texWidth * header.texHeight * header.bpp) / 8u)
+    if(header.texSize != static_cast<decltype(header.texSize)>(header.width * header.height * header.bpp) / 8u)
     {
         Log(LogLevel::WARN, "sh3_texture::Load( ): Warning, texSize != width * height * (bpp / 8)!");
-        return; // TODO: Bind a color shader here
+        return false; // TODO: Bind a color shader here
     }
 
-    data.resize(header.texSize); // Early data resize (if it's an 8bpp texture, it will be resized anyway)
-
-    width   = header.texWidth;
-    height  = header.texHeight;
-    bpp     = header.bpp;
-
-    if(header.bpp == PixelFormat::PALETTE)
+    if(header.bpp == CTexture::PixelFormat::PALETTE)
     {
         palette_info         pal_header;
-        std::vector<rgba>    palette;    // Palette Data (I think this is BGRA)
+        std::vector<rgba>    paletteData; // Palette Data (I think this is BGRA)
 
-        // First, we need to seek to the palette and read it in.
-        file.Seek(offset + header.batchHeaderSize + header.texFileSize, std::ios_base::beg);
-        file.ReadData(&pal_header, sizeof(pal_header), e);
+        // First, we need to find the palette and read it in.
+        if(!ReadStruct(file, entry.palette, pal_header))
+        {
+            Log(LogLevel::WARN, "sh3_texture::Load( ): Warning: Palette is missing!");
+            return false;
+        }
 
         // Palette information is stored in blocks (usually of size 64-bytes). We also know how large the
         // palette is (in bytes, including padding between blocks). From this, we can deduce (with a bit of math)
@@ -154,221 +286,371 @@ void CTexture::Load(sh3::arc::mft& mft, const std::string& filename)
         // entrySize/bypp colors per block, which therefore means we have a total of nBlocks * col_per_block colors,
         // which equates to about 256-colors in total (which seems accurate for an 8-bit texture).
 
-        const std::size_t nBlocks = (pal_header.paletteSize / pal_header.entrySize) / pal_header.bytes_per_pixel;
-        const std::size_t colorsPerBlock = pal_header.entrySize / pal_header.bytes_per_pixel;
+        const std::size_t nBlocks = GetPaletteBlockCount(pal_header);
+        const std::size_t colorsPerBlock = nBlocks != 0 ? pal_header.entrySize / pal_header.bytes_per_pixel : 0;
+        const std::size_t blockSize = std::min<std::size_t>(pal_header.entrySize, colorsPerBlock * sizeof(rgba));
 
-        palette.resize(colorsPerBlock * nBlocks);
+        paletteData.resize(colorsPerBlock * nBlocks);
 
         for(std::size_t block = 0; block < nBlocks; ++block)
         {
-            std::size_t read = file.ReadData(static_cast<void*>(&palette[block * colorsPerBlock]), pal_header.entrySize, e);
-
-            if(read != pal_header.entrySize)
+            // Each block is 256 bytes.
+            const std::size_t blockOffset = entry.palette + sizeof(pal_header) + block * 256;
+            if(blockOffset > file.size || file.size - blockOffset < blockSize)
             {
-                Log(LogLevel::WARN, "sh3_texture::Load( ): Warning: Number of bytes read in palette block != pal_header.entrySize! (Expected %lu, got %d)", read, pal_header.entrySize);
+                Log(LogLevel::WARN, "sh3_texture::Load( ): Warning: Palette is truncated after %zu blocks!", block);
                 break;
             }
-
-            // Each block is 256 bytes.
-            // Seek to next block.
-            file.Seek(256 - pal_header.entrySize, std::ios_base::cur);
+            std::memcpy(&paletteData[block * colorsPerBlock], file.data + blockOffset, blockSize);
         }
 
-        // we need to swap some colors every 32 pixels, starting from the 8th
-        static constexpr std::size_t swapDistance = 32; // distance between swaps
-        static constexpr std::size_t swapSize = 8; // amount of colors to swap
+        image.palette = BuildPalette(paletteData);
 
-        if(palette.size() > 8)
+        // Now that we've completely loaded the palette in its entirety, we can get the 8-bit index values
+        // from the data section of the file. They are uploaded as they are, and the shader looks up their color in the palette!
+
+        //===---THIS IS A CLUSTER FUCK FOR NOW UNTIL WE UNDERSTAND HOW IN THE NAME OF CHRIST THIS WORKS---===//
+        if(header.width > 96) // Apparently this is the distortion flag?!?!
         {
-            for(auto iter = next(begin(palette), 8); static_cast<std::size_t>(distance(iter, end(palette))) > swapDistance; advance(iter, swapDistance))
+            if(header.width % 16u != 0)
             {
-                // swap 8 colors
-                const auto swapBlock = next(iter, swapSize);
-                if(static_cast<std::size_t>(distance(swapBlock, end(palette))) < swapSize)
-                {
-                    Log(LogLevel::WARN, "Palette doesn't have enough colors left for swapping.");
-                    break;
-                }
-                std::swap_ranges(iter, swapBlock, swapBlock);
+                Log(LogLevel::WARN, "sh3_texture::Load( ): Warning: texWidth not divisible by 16!");
+                header.width = static_cast<decltype(header.width)>(header.width - header.width % 16u);
+            }
+
+            if(header.height % 4u != 0)
+            {
+                Log(LogLevel::WARN, "sh3_texture::Load ( ): Warning: texHeight not divisible by 4!");
+                header.height = static_cast<decltype(header.height)>(header.height - header.height % 4u);
             }
+
+            // Take all the indices at once and put them where they belong
+            const std::shared_ptr<const unswizzle_table> table = GetUnswizzleTable(header.width, header.height);
+            const std::size_t numIndices = entry.pixels < file.size ? std::min(table->size(), file.size - entry.pixels) : 0;
+            image.storage.resize(header.texSize);
+            Unswizzle8(numIndices != 0 ? file.data + entry.pixels : nullptr, numIndices, image.storage.data(), image.storage.size(), *table);
+            pixels = image.storage.data();
+        }
+        else // If the distortion flag isn't set, the indices are already in order.
+        {
+            pixels = GetPixels(file, entry.pixels, static_cast<std::size_t>(header.width * header.height), image.storage);
         }
 
+        image.format = image_format::INDEX8;
+    }
+    else if(header.bpp == CTexture::PixelFormat::RGBA)
+    {
+        pixels = GetPixels(file, entry.pixels, header.texSize, image.storage);
+        image.format = image_format::RGBA8;
+    }
+    else if(header.bpp == CTexture::PixelFormat::BGR)
+    {
+        pixels = GetPixels(file, entry.pixels, header.texSize, image.storage);
+        image.format = image_format::BGR8;
+    }
+    else if(header.bpp == CTexture::PixelFormat::RGBA16)
+    {
+        // A1B5G5R5 (see rgba16), which OpenGL can take as it is
+        pixels = GetPixels(file, entry.pixels, header.texSize, image.storage);
+        image.format = image_format::RGBA16;
+    }
+    else
+    {
+        Log(LogLevel::WARN, "sh3_texture::Load( ): Unknown Pixel Format, %d", header.bpp);
+        return false;
+    }
 
-        // Now that we've completely loaded the palette in its entirety, we can get the 8-bit index value
-        // from the data section of the file and get it's color in the palette!
+    image.width = header.width;
+    image.height = header.height;
+    image.levels.assign(1, {pixels, GetLevelSize(image.format, image.width, image.height, 0)});
+    return true;
+}
 
-        //===---THIS IS A CLUSTER FUCK FOR NOW UNTIL WE UNDERSTAND HOW IN THE NAME OF CHRIST THIS WORKS---===//
-        std::vector<std::uint8_t> iBuffer;  // Our index buffer that we put transformed indecies into
+/**
+ *  Read a whole texture file.
+ *
+ *  @returns A view of the file. If the file is streamed, it is valid until the next read.
+ */
+sh3::arc::file_span ReadTextureFile(sh3::arc::vfile& file)
+{
+    sh3::arc::vfile::read_error e;
+    file.Seek(0, std::ios_base::beg);
+    return file.ReadSpan(file.GetFilesize(), e);
+}
 
-        data.resize(static_cast<std::size_t>(header.texWidth * header.texHeight) * 3u); // We strip the Alpha channel from the BGRA pixel beacuse it is hard locked to 0x80 (not 0xFF!!)
-        iBuffer.resize(header.texSize);
+/**
+ *  Decode the first texture of a texture file that has already been read.
+ */
+bool DecodeTextureContents(const sh3::arc::file_span& contents, texture_image& image)
+{
+    std::vector<batch_entry> entries;
+    if(!ParseTextureBatch(contents, entries, 1) || !DecodeBatchEntry(contents, entries[0], image))
+    {
+        return false;
+    }
 
-        file.Seek(offset + (header.texFileSize - header.texSize), std::ios_base::beg); // Seek to the beginning of data
+    const texture_image::level& base = image.levels[0];
+    switch(image.format)
+    {
+    case image_format::RGBA8:
+        DumpRGB2Bitmap(image.width, image.height, base.data, base.size, 32);
+        break;
+    case image_format::BGR8:
+        DumpRGB2Bitmap(image.width, image.height, base.data, base.size, 24); // Output will be reversed!
+        break;
+    case image_format::RGBA16:
+        DumpRGB2Bitmap(image.width, image.height, base.data, base.size, 16);
+        break;
+    case image_format::INDEX8:
+        break;
+    }
+    return true;
+}
+}
 
-        if(header.texWidth > 96) // Apparently this is the distortion flag?!?!
+bool sh3::graphics::DecodeTexture(sh3::arc::vfile& file, texture_image& image)
+{
+    return DecodeTextureContents(ReadTextureFile(file), image);
+}
+
+bool sh3::graphics::DecodeTextureBatch(sh3::arc::vfile& file, std::vector<texture_image>& images)
+{
+    const sh3::arc::file_span contents = ReadTextureFile(file);
+
+    std::vector<batch_entry> entries;
+    if(!ParseTextureBatch(contents, entries, std::numeric_limits<std::size_t>::max()))
+    {
+        return false;
+    }
+
+    // Every texture only reads from the file, so they can all be decoded at once
+    images.clear();
+    images.resize(entries.size());
+    sh3::ParallelFor(entries.size(), [&](std::size_t i)
+    {
+        if(!DecodeBatchEntry(contents, entries[i], images[i]))
         {
-            if(header.texWidth % 16u != 0)
-            {
-                Log(LogLevel::WARN, "sh3_texture::Load( ): Warning: texWidth not divisible by 16!");
-                header.texWidth = static_cast<decltype(header.texWidth)>(header.texWidth - header.texWidth % 16u);
-            }
+            images[i] = texture_image();
+        }
+    });
+    return true;
+}
 
-            if(header.texHeight % 4u != 0)
-            {
-                Log(LogLevel::WARN, "sh3_texture::Load ( ): Warning: texHeight not divisible by 4!");
-                header.texHeight = static_cast<decltype(header.texHeight)>(header.texHeight - header.texHeight % 4u);
-            }
+bool sh3::graphics::LoadTextureImage(const sh3::arc::mft& mft, const std::string& filename, texture_image& image)
+{
+    // The source is read either way, so that a texture replaced in the .arc isn't served stale from the cache.
+    // That is still much cheaper than decoding it and building its mip levels again.
+    sh3::arc::vfile file(mft, filename);
+    return LoadTextureImage(mft, filename, file, image);
+}
 
-            std::uint32_t x = 0;
-            std::uint32_t y = 0;
-            bool offsetFlipper = false;
+bool sh3::graphics::LoadTextureImage(const sh3::arc::mft& mft, const std::string& filename, sh3::arc::vfile& file, texture_image& image)
+{
+    // Look for the decoded texture in the cache first, so that it doesn't have to be decoded again
+    sh3::arc::mft::load_error me;
+    sh3::arc::subarc::index_t index;
+    const sh3::arc::subarc* source = mft.FindFile(filename, index, me);
 
-            // We need to step through each index and unencrypt it
-            // FIXME: distortion on 16-pixel wide block on the left
-            while(true)
-            {
-                for(unsigned i = 0; i < 32; ++i)
-                {
-                    std::uint8_t index;
-                    file.ReadData(&index, sizeof(index), e);
-
-                    auto xoffset = static_cast<std::uint8_t>(((i << 2) & 0xfu) + ((i >> 2) & 0xfu));
-                    if(i > 16 && i % 2u) // aka (i & 17) == 17
-                    {
-                        xoffset ^= 8u;
-                        xoffset &= 0xfu;
-                    }
-                    if(offsetFlipper)
-                    {
-                        xoffset ^= 4u;
-                    }
-
-                    const auto tempx = x + xoffset - 16; // - 16;
-                    // every other pixel is for (y + 2)
-                    const auto tempy = y + ((i % 2u) ? 2u : 0u);
-
-                    iBuffer[(header.texWidth * tempy) + tempx % header.texWidth] = index;
-                }
-
-                x += 16;
-                if(x < header.texWidth)
-                {
-                    continue;
-                }
-
-                x = 0;
-
-                ++y;
-                if(y % 2 == 0)
-                {
-                    // each iteration we read two lines: offset 0 and 2
-                    // so after two iterations, we have read the lines with offset 0 and 2, 1 and 3
-                    // so now we need to skip two additional lines, since we read 2 and 3 already
-                    y += 2;
-
-                    if(y >= header.texHeight)
-                    {
-                        Log(LogLevel::WARN, "sh3_texture::Load( ): Warning: y <= header.texHeight!");
-                        break;
-                    }
-
-                    offsetFlipper = !offsetFlipper;
-                }
-
-                if(y == header.texHeight)
-                {
-                    break;
-                }
-            }
+    const sh3::arc::file_span contents = ReadTextureFile(file);
 
-            // Christ help me...
-            for(std::size_t pindex = 0, doff = 0; pindex < iBuffer.size() && doff < data.size(); pindex++, doff += 3)
-            {
-                rgba pixel = palette[iBuffer[pindex]];
+    std::string key;
+    std::uint32_t sourceSize = 0;
+    std::uint32_t sourceDigest = 0;
+    if(source != nullptr)
+    {
+        key = source->name + ':' + std::to_string(index);
+        sourceSize = static_cast<std::uint32_t>(contents.size);
+        sourceDigest = GetSourceDigest(contents.data, contents.size);
 
-                data[doff + 0]  = pixel.r;
-                data[doff + 1]  = pixel.g;
-                data[doff + 2]  = pixel.b;
-            }
-        }
-        else // If the distortion flag isn't set, just read the pixel data in from the palette.
+        if(LoadCachedTexture(key, sourceSize, sourceDigest, image))
         {
-            for(std::size_t i = 0; i < static_cast<std::size_t>(header.texWidth * header.texHeight) * 3u; i += 3)
-            {
-                std::uint8_t index;
-                file.ReadData(&index, sizeof(index), e);
-                rgba pixel = palette[index];
-
-                data[i + 0]   = pixel.r;
-                data[i + 1]   = pixel.g;
-                data[i + 2]   = pixel.b;
-            }
+            return true;
         }
-
-        DumpRGB2Bitmap(header.texWidth, header.texHeight, data, 24);
     }
-    else if(header.bpp == PixelFormat::RGBA)
+
+    if(!DecodeTextureContents(contents, image))
     {
-        file.ReadData(&data[0], header.texSize, e);
-        DumpRGB2Bitmap(header.texWidth, header.texHeight, data, 32);
+        return false;
     }
-    else if(header.bpp == PixelFormat::BGR)
+
+    BuildMipChain(image);
+    if(source != nullptr)
     {
-        file.ReadData(&data[0], header.texSize, e);
-        DumpRGB2Bitmap(header.texWidth, header.texHeight, data, 24); // Output will be reversed!
+        StoreCachedTexture(key, sourceSize, sourceDigest, image);
     }
-    else if(header.bpp == PixelFormat::RGBA16)
+
+    // Level 0 might still point into the file
+    const texture_image::level base = image.levels[0];
+    if(base.data < image.storage.data() || base.data >= image.storage.data() + image.storage.size())
     {
-        //TODO: Some kind of fucked up shit here. I think this is R5G5B5A1 or something like that..
-        file.ReadData(&data[0], header.texSize, e);
-        DumpRGB2Bitmap(header.texWidth, header.texHeight, data, 16);
+        ASSERT(image.levels.size() == 1);
+        image.storage.assign(base.data, base.data + base.size);
+        image.levels[0].data = image.storage.data();
     }
-    else
+    return true;
+}
+
+//TODO: Scale the texture and then
+void CTexture::Load(const sh3::arc::mft& mft, const std::string& filename)
+{
+    texture_image image;
+    if(LoadTextureImage(mft, filename, image))
     {
-        die("sh3_texture::Load( ): Unknown Pixel Format, %d", header.bpp);
+        Upload(image);
     }
+}
 
+void CTexture::Load(sh3::arc::vfile& file)
+{
+    texture_image image;
+    if(DecodeTexture(file, image))
+    {
+        Upload(image);
+    }
+}
 
-    glGenTextures(1, &tex);             // Create a texture
-    glBindTexture(GL_TEXTURE_2D, tex);  // Bind it for use
+void CTexture::Load(const sh3::arc::mft& mft, const std::string& filename, sh3::arc::vfile& file)
+{
+    texture_image image;
+    if(LoadTextureImage(mft, filename, file, image))
+    {
+        Upload(image);
+    }
+}
 
+void CTexture::Upload(const texture_image& image)
+{
     GLenum srcFormat;
-    GLint dstFormat;
+    GLenum dstFormat;
     GLenum type;
 
     // Create the texture according to its pixel format!
-    switch(header.bpp)
+    switch(image.format)
     {
-        case PixelFormat::RGBA:     // Regular 32-bit RGBA
+        case image_format::RGBA8:   // Regular 32-bit RGBA
             srcFormat = GL_RGBA;
-            dstFormat = GL_RGBA;
+            dstFormat = GL_RGBA8;
             type = GL_UNSIGNED_BYTE;
+            bpp = PixelFormat::RGBA;
             break;
-        case PixelFormat::BGR:      // 24-bit BGR
+        case image_format::BGR8:    // 24-bit BGR
             srcFormat = GL_BGR;
-            dstFormat = GL_RGB;
+            dstFormat = GL_RGB8;
             type = GL_UNSIGNED_BYTE;
+            bpp = PixelFormat::BGR;
             break;
-        case PixelFormat::RGBA16:   // 16-bit RGBA. OpenGL supports this (I think)
+        case image_format::RGBA16:  // 16-bit A1B5G5R5. Stays 16-bit on the GPU
             srcFormat = GL_RGBA;
-            dstFormat = GL_RGBA;
-            type = GL_UNSIGNED_SHORT_5_5_5_1;
+            dstFormat = GL_RGB5_A1;
+            type = GL_UNSIGNED_SHORT_1_5_5_5_REV;
+            bpp = PixelFormat::RGBA16;
             break;
-        case PixelFormat::PALETTE:
-            srcFormat = GL_RGB;
-            dstFormat = GL_RGB;
+        case image_format::INDEX8:  // 8-bit indices, looked up in the palette texture by the shader
+            srcFormat = GL_RED_INTEGER;
+            dstFormat = GL_R8UI;
             type = GL_UNSIGNED_BYTE;
+            bpp = PixelFormat::PALETTE;
             break;
         default:
-            die("sh3_texture::Load( ): Invalid pixel format: %d", header.bpp);
+            die("sh3_texture::Load( ): Invalid pixel format: %d", static_cast<int>(image.format));
+    }
+
+    ASSERT(!image.levels.empty());
+    Unload(); // In case this texture was loaded before
+    width   = image.width;
+    height  = image.height;
+
+    if(image.format == image_format::INDEX8)
+    {
+        glGenTextures(1, &palette);
+        glBindTexture(GL_TEXTURE_2D, palette);
+        if(GLEW_ARB_texture_storage)
+        {
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, static_cast<GLsizei>(image.palette.size()), 1);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, static_cast<GLsizei>(image.palette.size()), 1, GL_RGBA, GL_UNSIGNED_BYTE, image.palette.data());
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, static_cast<GLsizei>(image.palette.size()), 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.palette.data());
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        memoryUsage += sizeof(image.palette);
+    }
+
+    // Use the mip levels we have, or let the driver make them. Integer textures can't be filtered, so they don't get any.
+    const bool generateMips = image.format != image_format::INDEX8 && image.levels.size() == 1;
+    const std::size_t numLevels = generateMips ? GetMipLevelCount(image.width, image.height) : image.levels.size();
+
+    glGenTextures(1, &tex);             // Create a texture
+    glBindTexture(GL_TEXTURE_2D, tex);  // Bind it for use
+
+    // Allocate all levels at once (immutable storage, so the driver doesn't have to check the levels for completeness)
+    const bool immutable = GLEW_ARB_texture_storage;
+    if(immutable)
+    {
+        glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(numLevels), dstFormat, width, height);
+    }
+
+    // Stream the pixels in without waiting for the driver to copy them
+    CTextureUploader& uploader = CTextureUploader::Instance();
+    for(std::size_t level = 0; level < image.levels.size(); ++level)
+    {
+        const GLsizei levelWidth = std::max(width >> level, 1);
+        const GLsizei levelHeight = std::max(height >> level, 1);
+        if(!immutable)
+        {
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), static_cast<GLint>(dstFormat), levelWidth, levelHeight, 0, srcFormat, type, nullptr);
+        }
+        uploader.Upload(static_cast<GLint>(level), levelWidth, levelHeight, srcFormat, type, image.levels[level].data,
+                        GetLevelSize(image.format, image.width, image.height, level));
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(numLevels - 1));
+
+    for(std::size_t level = 0; level < numLevels; ++level)
+    {
+        memoryUsage += GetLevelSize(image.format, image.width, image.height, level);
+    }
+    if(generateMips)
+    {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    SetSampler(sampler);
+}
+
+void CTexture::SetSampler(const sampler_state& state)
+{
+    sampler = state;
+    if(tex == 0)
+    {
+        return; // Applied once the texture is loaded
+    }
+
+    sampler_state applied = state;
+    if(bpp == PixelFormat::PALETTE)
+    {
+        // Integer textures can't be filtered
+        applied.minFilter = GL_NEAREST;
+        applied.magFilter = GL_NEAREST;
+        applied.anisotropy = 1.0f;
     }
 
-    glTexImage2D(GL_TEXTURE_2D, 0, dstFormat, header.texWidth, header.texHeight, 0, srcFormat, type, data.data());
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, applied.wrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, applied.wrapT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, applied.magFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, applied.minFilter);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Use linear interpolation for the texture
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    if(GLEW_EXT_texture_filter_anisotropic)
+    {
+        GLfloat maxAnisotropy = 1.0f;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::clamp(applied.anisotropy, 1.0f, maxAnisotropy));
+    }
 
     glBindTexture(GL_TEXTURE_2D, 0); // Un-bind this texture.
 }
@@ -459,23 +741,31 @@ void CTexture::Load(const std::string& path)
     //std::reverse(data.begin(), data.end()); // Reverse the data because .bmp files are actually upside down in RAM
 
     // Do the actual texture upload
-    glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data.data());
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // Use linear interpolation for the texture
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-    glBindTexture(GL_TEXTURE_2D, 0); // Un-bind this texture.
+    ASSERT(width <= std::numeric_limits<std::uint16_t>::max() && height <= std::numeric_limits<std::uint16_t>::max());
+    texture_image image;
+    image.format = image_format::BGR8;
+    image.width = static_cast<std::uint16_t>(width);
+    image.height = static_cast<std::uint16_t>(height);
+    image.levels.push_back({data.data(), data.size()});
+    Upload(image);
 }
 
 void CTexture::Bind(GLenum textureUnit)
 {
     ASSERT(textureUnit >= GL_TEXTURE0 && textureUnit <= GL_TEXTURE31);
 
+    if(palette != 0)
+    {
+        ASSERT(textureUnit + 2 <= GL_TEXTURE31);
+
+        glActiveTexture(textureUnit + 1);
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glActiveTexture(textureUnit + 2);
+        glBindTexture(GL_TEXTURE_2D, palette);
+        glActiveTexture(textureUnit);
+        return;
+    }
+
     glActiveTexture(textureUnit);
     glBindTexture(GL_TEXTURE_2D, tex);
 }
@@ -485,3 +775,46 @@ void CTexture::Unbind()
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+CTexture::CTexture(CTexture&& rhs) noexcept
+    : width(rhs.width), height(rhs.height), bpp(rhs.bpp), tex(rhs.tex), palette(rhs.palette), sampler(rhs.sampler), memoryUsage(rhs.memoryUsage)
+{
+    rhs.tex = 0;
+    rhs.palette = 0;
+    rhs.memoryUsage = 0;
+}
+
+CTexture& CTexture::operator=(CTexture&& rhs) noexcept
+{
+    if(this != &rhs)
+    {
+        Unload();
+        width = rhs.width;
+        height = rhs.height;
+        bpp = rhs.bpp;
+        tex = rhs.tex;
+        palette = rhs.palette;
+        sampler = rhs.sampler;
+        memoryUsage = rhs.memoryUsage;
+        rhs.tex = 0;
+        rhs.palette = 0;
+        rhs.memoryUsage = 0;
+    }
+    return *this;
+}
+
+void CTexture::Unload() noexcept
+{
+    // Nothing to do, and no need for a GL context
+    if(tex == 0 && palette == 0)
+    {
+        return;
+    }
+
+    // Deleting 0 is ignored
+    glDeleteTextures(1, &tex);
+    glDeleteTextures(1, &palette);
+    tex = 0;
+    palette = 0;
+    memoryUsage = 0;
+}
+
@@ -0,0 +1,134 @@
+/** @file
+ *
+ *  Implementation of texture_array.hpp
+ *
+ *  @copyright 2016-2019  Palm Studios
+ */
+#include "SH3/graphics/texture_array.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SH3/arc/vfile.hpp"
+#include "SH3/common/parallel.hpp"
+#include "SH3/graphics/texture.hpp"
+#include "SH3/graphics/texture_cache.hpp"
+#include "SH3/system/assert.hpp"
+#include "SH3/system/log.hpp"
+
+using namespace sh3::graphics;
+
+CTextureArray::~CTextureArray()
+{
+    glDeleteTextures(1, &tex);
+}
+
+bool CTextureArray::Load(const sh3::arc::mft& mft, const std::string& filename)
+{
+    sh3::arc::vfile file(mft, filename);
+    std::vector<texture_image> images;
+    if(!DecodeTextureBatch(file, images))
+    {
+        Log(LogLevel::WARN, "CTextureArray::Load( ): Unable to load %s", filename.c_str());
+        return false;
+    }
+
+    Upload(images);
+    return true;
+}
+
+void CTextureArray::Upload(const std::vector<texture_image>& images)
+{
+    glDeleteTextures(1, &tex);
+    tex = 0;
+    width = 1;
+    height = 1;
+    layers.assign(images.size(), layer());
+
+    for(const texture_image& image : images)
+    {
+        if(!image.levels.empty())
+        {
+            width = std::max<GLsizei>(width, image.width);
+            height = std::max<GLsizei>(height, image.height);
+        }
+    }
+
+    // Convert every texture straight into its layer, so the whole array goes up in one call
+    const std::size_t layerWidth = static_cast<std::size_t>(width);
+    const std::size_t layerHeight = static_cast<std::size_t>(height);
+    const std::size_t layerSize = layerWidth * layerHeight * 4;
+    std::vector<std::uint8_t> pixels(layerSize * images.size(), 0);
+    sh3::ParallelFor(images.size(), [&](std::size_t i)
+    {
+        const texture_image& image = images[i];
+        if(image.levels.empty())
+        {
+            return;
+        }
+
+        std::vector<std::uint8_t> converted;
+        ConvertToRGBA8(image, converted);
+
+        const std::size_t rowSize = std::size_t{image.width} * 4;
+        for(std::size_t y = 0; y < image.height; ++y)
+        {
+            std::copy_n(converted.data() + y * rowSize, rowSize, pixels.data() + i * layerSize + y * layerWidth * 4);
+        }
+
+        layer& l = layers[i];
+        l.width = image.width;
+        l.height = image.height;
+        l.uScale = static_cast<GLfloat>(image.width) / static_cast<GLfloat>(width);
+        l.vScale = static_cast<GLfloat>(image.height) / static_cast<GLfloat>(height);
+    });
+
+    if(images.empty())
+    {
+        return;
+    }
+
+    const auto numLayers = static_cast<GLsizei>(images.size());
+    const std::size_t numLevels = GetMipLevelCount(static_cast<std::uint16_t>(width), static_cast<std::uint16_t>(height));
+
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, tex);
+    if(GLEW_ARB_texture_storage)
+    {
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLsizei>(numLevels), GL_RGBA8, width, height, numLayers);
+    }
+    else
+    {
+        for(std::size_t level = 0; level < numLevels; ++level)
+        {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), GL_RGBA8, std::max(width >> level, 1), std::max(height >> level, 1),
+                         numLayers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+    }
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, width, height, numLayers, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(numLevels - 1));
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void CTextureArray::Bind(GLenum textureUnit) const
+{
+    ASSERT(textureUnit >= GL_TEXTURE0 && textureUnit <= GL_TEXTURE31);
+
+    glActiveTexture(textureUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, tex);
+}
+
+const CTextureArray::layer& CTextureArray::GetLayer(std::size_t i) const
+{
+    ASSERT(i < layers.size());
+    return layers[i];
+}
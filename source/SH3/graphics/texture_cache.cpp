@@ -0,0 +1,354 @@
+/** @file
+ *
+ *  Implementation of texture_cache.hpp
+ *
+ *  @copyright 2016-2019  Palm Studios
+ */
+#include "SH3/graphics/texture_cache.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "SH3/system/assert.hpp"
+#include "SH3/system/log.hpp"
+#include "SH3/types/color.hpp"
+
+using namespace sh3::graphics;
+
+namespace
+{
+/**
+ *  The start of a cache file.
+ *
+ *  It is followed by the key, the palette (for @ref image_format::INDEX8 only) and the pixels of each level.
+ */
+struct cache_header final
+{
+    std::uint32_t magic;      /**< Always @ref expectedMagic. */
+    std::uint32_t version;    /**< Always @ref expectedVersion. */
+    std::uint32_t sourceSize; /**< Size of the file the texture was decoded from. */
+    std::uint32_t sourceCrc;  /**< CRC-32 of the file the texture was decoded from. */
+    std::uint16_t width;      /**< Width of level 0. */
+    std::uint16_t height;     /**< Height of level 0. */
+    std::uint8_t  format;     /**< @ref image_format of the pixels. */
+    std::uint8_t  numLevels;  /**< Number of mip levels. */
+    std::uint16_t keyLength;  /**< Length of the key. */
+
+    static constexpr std::uint32_t expectedMagic = 0x58455433; /**< "3TEX" */
+    static constexpr std::uint32_t expectedVersion = 2;       /**< Bumped whenever the layout or the decoding of textures changes. */
+};
+
+constexpr std::size_t maxLevels = 16; /**< Enough for a 65535x65535 texture. */
+
+/**
+ *  Get the number of bytes per pixel of a format.
+ */
+std::size_t GetBytesPerPixel(image_format format)
+{
+    switch(format)
+    {
+    case image_format::RGBA8:
+        return 4;
+    case image_format::BGR8:
+        return 3;
+    case image_format::RGBA16:
+        return 2;
+    case image_format::INDEX8:
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ *  Get the path of the cache file for a key.
+ */
+std::string GetCachePath(const std::string& key)
+{
+    const std::string versionedKey = key + '#' + std::to_string(cache_header::expectedVersion);
+    const auto crc = static_cast<std::uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(versionedKey.data()), static_cast<uInt>(versionedKey.size())));
+
+    char name[16];
+    std::snprintf(name, sizeof(name), "%08" PRIx32, crc);
+    return std::string("data/texcache/") + name + ".tex";
+}
+
+/**
+ *  Halve a level of an 8-bit per channel texture with a box filter.
+ */
+void Downsample(const std::uint8_t* src, std::size_t srcWidth, std::size_t srcHeight, std::uint8_t* dst, std::size_t bytesPerPixel)
+{
+    const std::size_t dstWidth = std::max<std::size_t>(srcWidth / 2, 1);
+    const std::size_t dstHeight = std::max<std::size_t>(srcHeight / 2, 1);
+
+    for(std::size_t y = 0; y < dstHeight; ++y)
+    {
+        const std::uint8_t* row0 = src + std::min(y * 2, srcHeight - 1) * srcWidth * bytesPerPixel;
+        const std::uint8_t* row1 = src + std::min(y * 2 + 1, srcHeight - 1) * srcWidth * bytesPerPixel;
+        for(std::size_t x = 0; x < dstWidth; ++x)
+        {
+            const std::size_t x0 = std::min(x * 2, srcWidth - 1) * bytesPerPixel;
+            const std::size_t x1 = std::min(x * 2 + 1, srcWidth - 1) * bytesPerPixel;
+            for(std::size_t c = 0; c < bytesPerPixel; ++c)
+            {
+                const unsigned sum = 2u + row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                *dst++ = static_cast<std::uint8_t>(sum / 4);
+            }
+        }
+    }
+}
+
+/**
+ *  Scale a 5-bit color channel to 8 bits.
+ */
+std::uint8_t Expand5(std::uint8_t value)
+{
+    return static_cast<std::uint8_t>((value << 3) | (value >> 2));
+}
+}
+
+std::size_t sh3::graphics::GetLevelSize(image_format format, std::uint16_t width, std::uint16_t height, std::size_t level)
+{
+    const std::size_t levelWidth = std::max<std::size_t>(std::size_t{width} >> level, 1);
+    const std::size_t levelHeight = std::max<std::size_t>(std::size_t{height} >> level, 1);
+    return levelWidth * levelHeight * GetBytesPerPixel(format);
+}
+
+std::size_t sh3::graphics::GetMipLevelCount(std::uint16_t width, std::uint16_t height)
+{
+    std::size_t numLevels = 1;
+    while((width >> numLevels) != 0 || (height >> numLevels) != 0)
+    {
+        ++numLevels;
+    }
+    return numLevels;
+}
+
+void sh3::graphics::BuildMipChain(texture_image& image)
+{
+    if((image.format != image_format::RGBA8 && image.format != image_format::BGR8) || image.levels.size() != 1 || image.width == 0 || image.height == 0)
+    {
+        return;
+    }
+
+    const std::size_t bytesPerPixel = GetBytesPerPixel(image.format);
+    ASSERT(image.levels[0].size >= GetLevelSize(image.format, image.width, image.height, 0));
+
+    const std::size_t numLevels = GetMipLevelCount(image.width, image.height);
+
+    std::vector<std::size_t> offsets(numLevels);
+    std::size_t total = 0;
+    for(std::size_t level = 0; level < numLevels; ++level)
+    {
+        offsets[level] = total;
+        total += GetLevelSize(image.format, image.width, image.height, level);
+    }
+
+    std::vector<std::uint8_t> storage(total);
+    std::copy_n(image.levels[0].data, offsets.size() > 1 ? offsets[1] : total, storage.begin());
+    for(std::size_t level = 1; level < numLevels; ++level)
+    {
+        Downsample(&storage[offsets[level - 1]], std::max<std::size_t>(std::size_t{image.width} >> (level - 1), 1),
+                   std::max<std::size_t>(std::size_t{image.height} >> (level - 1), 1), &storage[offsets[level]], bytesPerPixel);
+    }
+
+    image.storage = std::move(storage);
+    image.levels.clear();
+    for(std::size_t level = 0; level < numLevels; ++level)
+    {
+        image.levels.push_back({image.storage.data() + offsets[level], GetLevelSize(image.format, image.width, image.height, level)});
+    }
+}
+
+void sh3::graphics::ConvertToRGBA8(const texture_image& image, std::vector<std::uint8_t>& pixels)
+{
+    const std::size_t numPixels = std::size_t{image.width} * image.height;
+    const texture_image::level& base = image.levels[0];
+    pixels.resize(numPixels * 4);
+
+    switch(image.format)
+    {
+    case image_format::RGBA8:
+        std::copy_n(base.data, numPixels * 4, pixels.begin());
+        break;
+    case image_format::BGR8:
+        for(std::size_t i = 0; i < numPixels; ++i)
+        {
+            pixels[i * 4 + 0] = base.data[i * 3 + 2];
+            pixels[i * 4 + 1] = base.data[i * 3 + 1];
+            pixels[i * 4 + 2] = base.data[i * 3 + 0];
+            pixels[i * 4 + 3] = 0xff;
+        }
+        break;
+    case image_format::RGBA16:
+        for(std::size_t i = 0; i < numPixels; ++i)
+        {
+            rgba16 pixel;
+            std::memcpy(&pixel.value, base.data + i * 2, sizeof(pixel.value));
+            pixels[i * 4 + 0] = Expand5(pixel.r());
+            pixels[i * 4 + 1] = Expand5(pixel.g());
+            pixels[i * 4 + 2] = Expand5(pixel.b());
+            pixels[i * 4 + 3] = pixel.a() ? 0xff : 0x00;
+        }
+        break;
+    case image_format::INDEX8:
+        ExpandPalette(base.data, base.size, image.palette, pixels.data(), numPixels, pixel_layout::RGBA8);
+        break;
+    }
+}
+
+std::uint32_t sh3::graphics::GetSourceDigest(const std::uint8_t* data, std::size_t size)
+{
+    uLong crc = crc32(0, Z_NULL, 0);
+    while(size > 0)
+    {
+        // uInt might not hold the whole size
+        const auto chunk = static_cast<uInt>(std::min<std::size_t>(size, std::numeric_limits<uInt>::max()));
+        crc = crc32(crc, reinterpret_cast<const Bytef*>(data), chunk);
+        data += chunk;
+        size -= chunk;
+    }
+    return static_cast<std::uint32_t>(crc);
+}
+
+bool sh3::graphics::LoadCachedTexture(const std::string& key, std::uint32_t sourceSize, std::uint32_t sourceDigest, texture_image& image)
+{
+    std::ifstream file(GetCachePath(key), std::ios::binary | std::ios::ate);
+    if(!file)
+    {
+        return false;
+    }
+
+    const std::streamoff fileSize = file.tellg();
+    if(fileSize < static_cast<std::streamoff>(sizeof(cache_header)))
+    {
+        return false;
+    }
+
+    std::vector<std::uint8_t> storage(static_cast<std::size_t>(fileSize));
+    file.seekg(0, std::ios_base::beg);
+    if(!file.read(reinterpret_cast<char*>(storage.data()), fileSize))
+    {
+        return false;
+    }
+
+    cache_header header;
+    std::memcpy(&header, storage.data(), sizeof(header));
+    if(header.magic != cache_header::expectedMagic || header.version != cache_header::expectedVersion)
+    {
+        return false;
+    }
+
+    const auto format = static_cast<image_format>(header.format);
+    if(header.format > static_cast<std::uint8_t>(image_format::INDEX8) || header.numLevels == 0 || header.numLevels > maxLevels)
+    {
+        Log(LogLevel::WARN, "LoadCachedTexture( ): Cached texture for %s is corrupt", key.c_str());
+        return false;
+    }
+
+    std::size_t pos = sizeof(header);
+    if(header.keyLength != key.size() || storage.size() - pos < key.size() || key.compare(0, key.size(), reinterpret_cast<const char*>(&storage[pos]), key.size()) != 0)
+    {
+        return false; // Another texture with the same hash
+    }
+    pos += key.size();
+
+    if(header.sourceSize != sourceSize || header.sourceCrc != sourceDigest)
+    {
+        Log(LogLevel::INFO, "LoadCachedTexture( ): Cached texture for %s is out of date", key.c_str());
+        return false;
+    }
+
+    image.palette = {};
+    if(format == image_format::INDEX8)
+    {
+        if(storage.size() - pos < sizeof(image.palette))
+        {
+            Log(LogLevel::WARN, "LoadCachedTexture( ): Cached texture for %s is truncated", key.c_str());
+            return false;
+        }
+        std::memcpy(image.palette.data(), &storage[pos], sizeof(image.palette));
+        pos += sizeof(image.palette);
+    }
+
+    image.levels.clear();
+    for(std::size_t level = 0; level < header.numLevels; ++level)
+    {
+        const std::size_t size = GetLevelSize(format, header.width, header.height, level);
+        if(storage.size() - pos < size)
+        {
+            Log(LogLevel::WARN, "LoadCachedTexture( ): Cached texture for %s is truncated", key.c_str());
+            return false;
+        }
+        image.levels.push_back({storage.data() + pos, size});
+        pos += size;
+    }
+
+    image.format = format;
+    image.width = header.width;
+    image.height = header.height;
+    image.storage = std::move(storage); // The buffer (and the levels pointing into it) stays where it is
+    return true;
+}
+
+bool sh3::graphics::StoreCachedTexture(const std::string& key, std::uint32_t sourceSize, std::uint32_t sourceDigest, const texture_image& image)
+{
+    ASSERT(!image.levels.empty() && image.levels.size() <= maxLevels);
+    ASSERT(key.size() <= UINT16_MAX);
+
+    cache_header header;
+    header.magic = cache_header::expectedMagic;
+    header.version = cache_header::expectedVersion;
+    header.sourceSize = sourceSize;
+    header.sourceCrc = sourceDigest;
+    header.width = image.width;
+    header.height = image.height;
+    header.format = static_cast<std::uint8_t>(image.format);
+    header.numLevels = static_cast<std::uint8_t>(image.levels.size());
+    header.keyLength = static_cast<std::uint16_t>(key.size());
+
+    const std::string path = GetCachePath(key);
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(key.data(), static_cast<std::streamsize>(key.size()));
+        if(image.format == image_format::INDEX8)
+        {
+            out.write(reinterpret_cast<const char*>(image.palette.data()), sizeof(image.palette));
+        }
+        for(std::size_t level = 0; level < image.levels.size(); ++level)
+        {
+            // Only write what LoadCachedTexture will read back (level 0 might be padded)
+            const std::size_t size = GetLevelSize(image.format, image.width, image.height, level);
+            ASSERT(image.levels[level].size >= size);
+            out.write(reinterpret_cast<const char*>(image.levels[level].data), static_cast<std::streamsize>(size));
+        }
+        out.close();
+        if(!out)
+        {
+            Log(LogLevel::WARN, "StoreCachedTexture( ): Unable to write %s", tmpPath.c_str());
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+
+    // rename() does not replace an existing file everywhere
+    std::remove(path.c_str());
+    if(std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        Log(LogLevel::WARN, "StoreCachedTexture( ): Unable to move %s to %s", tmpPath.c_str(), path.c_str());
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
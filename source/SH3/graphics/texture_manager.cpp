@@ -0,0 +1,180 @@
+/** @file
+ *
+ *  Implementation of texture_manager.hpp
+ *
+ *  @copyright 2016-2019  Palm Studios
+ */
+#include "SH3/graphics/texture_manager.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "SH3/system/assert.hpp"
+#include "SH3/system/log.hpp"
+
+using namespace sh3::graphics;
+
+CTextureManager::handle::handle(record* r)
+    : rec(r)
+{
+    ++rec->refs;
+}
+
+CTextureManager::handle::handle(const handle& rhs)
+    : rec(rhs.rec)
+{
+    if(rec != nullptr)
+    {
+        ++rec->refs;
+    }
+}
+
+CTextureManager::handle::handle(handle&& rhs) noexcept
+    : rec(rhs.rec)
+{
+    rhs.rec = nullptr;
+}
+
+CTextureManager::handle::~handle()
+{
+    if(rec != nullptr)
+    {
+        CTextureManager::Instance().Release(*rec);
+    }
+}
+
+CTextureManager::handle& CTextureManager::handle::operator=(handle rhs) noexcept
+{
+    std::swap(rec, rhs.rec);
+    return *this;
+}
+
+void CTextureManager::handle::Bind(GLenum textureUnit) const
+{
+    ASSERT(rec != nullptr);
+    CTextureManager::Instance().Use(*rec);
+    rec->texture.Bind(textureUnit);
+}
+
+bool CTextureManager::handle::IsPaletted() const
+{
+    ASSERT(rec != nullptr);
+    return rec->paletted;
+}
+
+CTextureManager::~CTextureManager()
+{
+    for(auto& entry : records)
+    {
+        if(entry.second->refs != 0)
+        {
+            Log(LogLevel::WARN, "CTextureManager: %s is still in use", entry.first.c_str());
+        }
+        if(entry.second->texture.IsLoaded())
+        {
+            // There is no GL context left to delete it with
+            Log(LogLevel::WARN, "CTextureManager: %s was not cleared, leaking it", entry.first.c_str());
+            static_cast<void>(entry.second.release());
+        }
+    }
+}
+
+void CTextureManager::Clear()
+{
+    for(auto it = records.begin(); it != records.end();)
+    {
+        it->second->texture.Unload();
+        if(it->second->refs == 0)
+        {
+            it = records.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    memoryUsage = 0;
+}
+
+CTextureManager::handle CTextureManager::Get(const sh3::arc::mft& mft, const std::string& filename)
+{
+    std::unique_ptr<record>& rec = records[filename];
+    if(!rec)
+    {
+        rec = std::make_unique<record>();
+        rec->mft = &mft;
+        rec->filename = filename;
+    }
+
+    Use(*rec);
+    return handle(rec.get());
+}
+
+void CTextureManager::SetBudget(std::size_t bytes)
+{
+    budget = bytes;
+    Evict(nullptr);
+}
+
+void CTextureManager::Use(record& rec)
+{
+    rec.lastUsed = ++clock;
+    if(rec.texture.IsLoaded() || rec.broken)
+    {
+        return;
+    }
+
+    rec.texture.Load(*rec.mft, rec.filename);
+    if(!rec.texture.IsLoaded())
+    {
+        rec.broken = true; // Don't try again every time it is bound
+        return;
+    }
+    rec.paletted = rec.texture.IsPaletted();
+    memoryUsage += rec.texture.GetMemoryUsage();
+    Evict(&rec);
+}
+
+void CTextureManager::Release(record& rec)
+{
+    ASSERT(rec.refs > 0);
+    --rec.refs;
+
+    // Keep it loaded for now, it might be used again soon. It is forgotten once it is evicted.
+    if(rec.refs == 0 && !rec.texture.IsLoaded())
+    {
+        const std::string filename = rec.filename; // rec goes away with the erase
+        records.erase(filename);
+    }
+}
+
+void CTextureManager::Evict(const record* keep)
+{
+    while(memoryUsage > budget)
+    {
+        record* oldest = nullptr;
+        for(const auto& entry : records)
+        {
+            record* rec = entry.second.get();
+            if(rec != keep && rec->texture.IsLoaded() && (oldest == nullptr || rec->lastUsed < oldest->lastUsed))
+            {
+                oldest = rec;
+            }
+        }
+
+        if(oldest == nullptr)
+        {
+            Log(LogLevel::WARN, "CTextureManager: %s alone exceeds the texture budget", keep != nullptr ? keep->filename.c_str() : "");
+            return;
+        }
+
+        memoryUsage -= oldest->texture.GetMemoryUsage();
+        oldest->texture.Unload();
+        if(oldest->refs == 0)
+        {
+            const std::string filename = oldest->filename; // oldest goes away with the erase
+            records.erase(filename);
+        }
+    }
+}
@@ -0,0 +1,148 @@
+/** @file
+ *
+ *  Implementation of texture_upload.hpp
+ *
+ *  @copyright 2016-2019  Palm Studios
+ */
+#include "SH3/graphics/texture_upload.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "SH3/system/log.hpp"
+
+using namespace sh3::graphics;
+
+namespace
+{
+constexpr std::size_t alignment = 16; /**< Alignment of each upload in the ring. */
+}
+
+CTextureUploader::CTextureUploader()
+{
+    if(!GLEW_ARB_buffer_storage)
+    {
+        Log(LogLevel::INFO, "CTextureUploader: ARB_buffer_storage is not supported, uploading textures directly");
+        return;
+    }
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &pbo);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(RING_SIZE), nullptr, flags);
+    mapping = static_cast<std::uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(RING_SIZE), flags));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if(mapping == nullptr)
+    {
+        Log(LogLevel::WARN, "CTextureUploader: Unable to map the upload ring, uploading textures directly");
+        glDeleteBuffers(1, &pbo);
+        pbo = 0;
+    }
+}
+
+CTextureUploader::~CTextureUploader()
+{
+    if(pbo != 0 || !inFlight.empty())
+    {
+        Log(LogLevel::WARN, "CTextureUploader: Not shut down, leaking the upload ring");
+    }
+}
+
+void CTextureUploader::Shutdown()
+{
+    for(const in_flight& upload : inFlight)
+    {
+        glClientWaitSync(upload.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(upload.fence);
+    }
+    inFlight.clear();
+
+    if(pbo != 0)
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(1, &pbo);
+    }
+    pbo = 0;
+    mapping = nullptr;
+    head = 0;
+}
+
+void CTextureUploader::Upload(GLint level, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels, std::size_t size)
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    std::size_t offset;
+    if(pbo == 0 || size == 0 || !Allocate(size, offset))
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, format, type, pixels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        return;
+    }
+
+    std::memcpy(mapping + offset, pixels, size);
+
+    // With a buffer bound, the "pointer" is an offset into it
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, format, type, reinterpret_cast<const void*>(offset));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    inFlight.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), offset, offset + size});
+    head = offset + size;
+}
+
+void CTextureUploader::Poll()
+{
+    while(!inFlight.empty())
+    {
+        const GLenum status = glClientWaitSync(inFlight.front().fence, 0, 0);
+        if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        {
+            break;
+        }
+        glDeleteSync(inFlight.front().fence);
+        inFlight.pop_front();
+    }
+}
+
+bool CTextureUploader::Allocate(std::size_t size, std::size_t& offset)
+{
+    Poll();
+
+    const std::size_t start = (head + alignment - 1) / alignment * alignment;
+    if(inFlight.empty())
+    {
+        // Nothing in use, start over at the beginning
+        offset = 0;
+        return size <= RING_SIZE;
+    }
+
+    // The uploads in use go from tail to head, possibly wrapping around the end of the ring. The room in front of
+    // tail is never filled up completely, so that head == tail can't happen
+    const std::size_t tail = inFlight.front().begin;
+    if(head > tail)
+    {
+        if(start + size <= RING_SIZE)
+        {
+            offset = start;
+            return true;
+        }
+        if(size < tail)
+        {
+            offset = 0;
+            return true;
+        }
+        return false;
+    }
+
+    if(start + size < tail)
+    {
+        offset = start;
+        return true;
+    }
+    return false;
+}
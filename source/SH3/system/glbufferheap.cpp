@@ -0,0 +1,159 @@
+/** @file
+ *
+ *  Implementation of glbufferheap.hpp
+ *
+ *  @copyright 2016-2019 Palm Studios
+ */
+#include "SH3/system/glbufferheap.hpp"
+#include "SH3/system/assert.hpp"
+#include "SH3/system/log.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+using namespace sh3::gl;
+
+CBufferHeap::CBufferHeap(CVertexBuffer::BufferTarget _target, GLsizeiptr _blockSize, const std::string& _name)
+    : name(_name), target(_target), blockSize(_blockSize)
+{
+    ASSERT(blockSize > 0);
+}
+
+CBufferHeap::~CBufferHeap()
+{
+    for(block& b : blocks)
+        glDeleteBuffers(1, &b.buffer);
+}
+
+CBufferHeap::allocation CBufferHeap::Allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+    ASSERT(alignment > 0);
+    if(size <= 0)
+        return {};
+
+    for(block& b : blocks)
+    {
+        const allocation alloc = Allocate(b, size, alignment);
+        if(alloc)
+            return alloc;
+    }
+
+    // No room anywhere, so add a block. A block always starts out aligned
+    block b;
+    b.size = std::max(blockSize, size);
+    // Created with DSA, so a VAO that happens to be bound keeps its element buffer
+    glCreateBuffers(1, &b.buffer);
+    glNamedBufferStorage(b.buffer, b.size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    // A failed glNamedBufferStorage leaves the buffer without storage
+    GLint64 storageSize = 0;
+    glGetNamedBufferParameteri64v(b.buffer, GL_BUFFER_SIZE, &storageSize);
+    if(storageSize != b.size)
+    {
+        Log(LogLevel::ERROR, "CBufferHeap::Allocate(): Unable to create a block of %ld bytes for %s!", static_cast<long>(b.size), name.c_str());
+        glDeleteBuffers(1, &b.buffer);
+        return {};
+    }
+
+    AddFreeRange(b, 0, b.size);
+    blocks.push_back(std::move(b));
+    return Allocate(blocks.back(), size, alignment);
+}
+
+CBufferHeap::allocation CBufferHeap::Allocate(block& b, GLsizeiptr size, GLsizeiptr alignment)
+{
+    // Smallest free range the allocation fits into, including the padding for its alignment
+    for(auto it = b.freeBySize.lower_bound(size); it != b.freeBySize.end(); ++it)
+    {
+        const GLintptr rangeOffset = it->second;
+        const GLsizeiptr rangeSize = it->first;
+        const GLintptr start = (rangeOffset + alignment - 1) / alignment * alignment;
+        if(start + size > rangeOffset + rangeSize)
+            continue;
+
+        b.freeBySize.erase(it);
+        b.freeByOffset.erase(rangeOffset);
+
+        // Give back what is left on either side
+        if(start > rangeOffset)
+            AddFreeRange(b, rangeOffset, start - rangeOffset);
+        if(start + size < rangeOffset + rangeSize)
+            AddFreeRange(b, start + size, rangeOffset + rangeSize - (start + size));
+
+        used += size;
+
+        allocation alloc;
+        alloc.buffer = b.buffer;
+        alloc.offset = start;
+        alloc.size = size;
+        return alloc;
+    }
+    return {};
+}
+
+void CBufferHeap::Free(const allocation& alloc)
+{
+    if(!alloc)
+        return;
+
+    auto b = std::find_if(blocks.begin(), blocks.end(), [&](const block& candidate){return candidate.buffer == alloc.buffer;});
+    if(b == blocks.end())
+    {
+        Log(LogLevel::ERROR, "CBufferHeap::Free(): Buffer %u is not part of %s!", alloc.buffer, name.c_str());
+        return;
+    }
+
+    ASSERT(alloc.offset >= 0 && alloc.offset + alloc.size <= b->size);
+    AddFreeRange(*b, alloc.offset, alloc.size);
+    used -= alloc.size;
+}
+
+void CBufferHeap::Upload(const allocation& alloc, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    ASSERT(alloc && offset >= 0 && offset + size <= alloc.size);
+    glNamedBufferSubData(alloc.buffer, alloc.offset + offset, size, data);
+}
+
+void CBufferHeap::AddFreeRange(block& b, GLintptr offset, GLsizeiptr size)
+{
+    // Merge with the free range after this one...
+    auto next = b.freeByOffset.lower_bound(offset);
+    ASSERT(next == b.freeByOffset.end() || next->first >= offset + size); // Freed twice?
+    if(next != b.freeByOffset.end() && next->first == offset + size)
+    {
+        size += next->second;
+        EraseBySize(b, next->first, next->second);
+        next = b.freeByOffset.erase(next);
+    }
+
+    // ...and the one before it
+    if(next != b.freeByOffset.begin())
+    {
+        auto prev = std::prev(next);
+        ASSERT(prev->first + prev->second <= offset); // Freed twice?
+        if(prev->first + prev->second == offset)
+        {
+            EraseBySize(b, prev->first, prev->second);
+            offset = prev->first;
+            size += prev->second;
+            b.freeByOffset.erase(prev);
+        }
+    }
+
+    b.freeByOffset.emplace(offset, size);
+    b.freeBySize.emplace(size, offset);
+}
+
+void CBufferHeap::EraseBySize(block& b, GLintptr offset, GLsizeiptr size)
+{
+    const auto range = b.freeBySize.equal_range(size);
+    for(auto it = range.first; it != range.second; ++it)
+    {
+        if(it->second == offset)
+        {
+            b.freeBySize.erase(it);
+            return;
+        }
+    }
+}
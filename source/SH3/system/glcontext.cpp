@@ -132,7 +132,7 @@ CRenderContext::CRenderContext(CWindow& hwnd)
 void CRenderContext::Create(CWindow& hwnd)
 {
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 5); // Direct state access (CVertexArray, CVertexBuffer, vertex_layout) is core in 4.5
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG); // Put the context into 'forwrad compatible' mode, meaning no deprecated functionality will be allowed AT ALL!
 
     glContext.reset(SDL_GL_CreateContext(const_cast<SDL_Window*>(hwnd.GetHandle())));
@@ -146,6 +146,11 @@ void CRenderContext::Create(CWindow& hwnd)
         die(err.c_str());
     }
 
+    if(!GLEW_ARB_direct_state_access)
+    {
+        die("CRenderContext::CRenderContext( ): OpenGL 4.5 or GL_ARB_direct_state_access is required!");
+    }
+
     // Set the colour size for OpenGL!
     SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
     SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
@@ -0,0 +1,113 @@
+/** @file
+ *
+ *  Implementation of glstreambuffer.hpp
+ *
+ *  @copyright 2016-2019 Palm Studios
+ */
+#include "SH3/system/glstreambuffer.hpp"
+#include "SH3/system/assert.hpp"
+#include "SH3/system/log.hpp"
+
+using namespace sh3::gl;
+
+namespace
+{
+/**
+ * Wait for a fence and delete it.
+ */
+void WaitFence(GLsync& fence)
+{
+    if(fence == nullptr)
+        return;
+
+    GLenum status;
+    do
+    {
+        status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1ms
+    } while(status == GL_TIMEOUT_EXPIRED);
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+}
+
+CStreamBuffer::CStreamBuffer(CVertexBuffer::BufferTarget _target, GLsizeiptr _frameSize, std::size_t numFrames, const std::string& _name)
+    : name(_name), target(_target), frameSize(_frameSize), fences(numFrames, nullptr)
+{
+    ASSERT(numFrames > 0 && frameSize > 0);
+
+    const GLsizeiptr size = frameSize * static_cast<GLsizeiptr>(numFrames);
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &vboID);
+    glNamedBufferStorage(vboID, size, nullptr, flags);
+    mapping = static_cast<std::uint8_t*>(glMapNamedBufferRange(vboID, 0, size, flags));
+
+    if(mapping == nullptr)
+    {
+        Log(LogLevel::WARN, "CStreamBuffer: Unable to map %s, staging it in system memory instead", name.c_str());
+
+        // Immutable storage can't be respecified (and rejects glNamedBufferSubData without GL_DYNAMIC_STORAGE_BIT),
+        // so start over with a plain buffer object
+        glDeleteBuffers(1, &vboID);
+        glCreateBuffers(1, &vboID);
+        glNamedBufferData(vboID, size, nullptr, GL_STREAM_DRAW);
+        staging.resize(static_cast<std::size_t>(frameSize));
+    }
+}
+
+CStreamBuffer::~CStreamBuffer()
+{
+    for(GLsync& fence : fences)
+        WaitFence(fence);
+
+    if(mapping != nullptr)
+        glUnmapNamedBuffer(vboID);
+    glDeleteBuffers(1, &vboID);
+}
+
+void CStreamBuffer::BeginFrame()
+{
+    frame = (frame + 1) % fences.size();
+    head = 0;
+    flushed = 0;
+
+    // The GPU is usually done with this region by now, so this hardly ever blocks
+    WaitFence(fences[frame]);
+}
+
+CStreamBuffer::slice CStreamBuffer::Allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+    ASSERT(alignment > 0);
+
+    const GLsizeiptr start = (head + alignment - 1) / alignment * alignment;
+    if(size <= 0 || start + size > frameSize)
+    {
+        Log(LogLevel::WARN, "CStreamBuffer::Allocate(): %s has no room for %ld bytes this frame!", name.c_str(), static_cast<long>(size));
+        return {};
+    }
+
+    head = start + size;
+
+    slice s;
+    s.offset = GetFrameOffset() + start;
+    s.data = mapping != nullptr ? mapping + s.offset : staging.data() + start;
+    s.size = size;
+    return s;
+}
+
+void CStreamBuffer::Flush()
+{
+    if(mapping != nullptr || flushed == head)
+        return;
+
+    glNamedBufferSubData(vboID, GetFrameOffset() + flushed, head - flushed, staging.data() + flushed);
+    flushed = head;
+}
+
+void CStreamBuffer::EndFrame()
+{
+    Flush();
+
+    ASSERT(fences[frame] == nullptr);
+    fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
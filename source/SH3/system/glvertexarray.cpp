@@ -11,6 +11,8 @@
  */
 #include "SH3/system/glvertexarray.hpp"
 
+#include <utility>
+
 using namespace sh3::gl;
 
 CVertexArray::CVertexArray()
@@ -25,10 +27,22 @@ CVertexArray::CVertexArray(const std::string& _name)
     Create();
 }
 
-CVertexArray::CVertexArray(const CVertexArray& rhs)
-    : vaoID(rhs.vaoID), name(rhs.name)
+CVertexArray::CVertexArray(CVertexArray&& rhs) noexcept
+    : vaoID(rhs.vaoID), name(std::move(rhs.name))
 {
+    rhs.vaoID = VAO_UNBIND;
+}
 
+CVertexArray& CVertexArray::operator=(CVertexArray&& rhs) noexcept
+{
+    if(this != &rhs)
+    {
+        Destroy();
+        vaoID = rhs.vaoID;
+        name = std::move(rhs.name);
+        rhs.vaoID = VAO_UNBIND;
+    }
+    return *this;
 }
 
 CVertexArray::~CVertexArray()
@@ -38,12 +52,13 @@ CVertexArray::~CVertexArray()
 
 inline void CVertexArray::Create(void) noexcept
 {
-    glGenVertexArrays(1, &vaoID);
+    glCreateVertexArrays(1, &vaoID); // Not glGenVertexArrays, the VAO has to exist for the glVertexArray* functions
 }
 
 inline void CVertexArray::Destroy(void) noexcept
 {
-    glDeleteVertexArrays(1, &vaoID);
+    glDeleteVertexArrays(1, &vaoID); // Deleting 0 (a moved-from VAO) is ignored
+    vaoID = VAO_UNBIND;
 }
 
 void CVertexArray::BindAttribute(const VertexAttribute& attrib, const CVertexBuffer& vbo, VertexAttribute::AttributeType type)
@@ -62,3 +77,13 @@ void CVertexArray::BindAttribute(const GLuint idx, const CVertexBuffer& vbo, GLi
     glVertexAttribPointer(idx, size, type, normalize, stride, reinterpret_cast<const GLvoid*>(offset));
 
 }
+
+void CVertexArray::BindVertexBuffer(GLuint buffer, GLintptr offset, GLsizei stride, GLuint binding)
+{
+    glVertexArrayVertexBuffer(vaoID, binding, buffer, offset, stride);
+}
+
+void CVertexArray::BindElementBuffer(GLuint buffer)
+{
+    glVertexArrayElementBuffer(vaoID, buffer);
+}
@@ -12,22 +12,54 @@
 #include "SH3/system/glvertexbuffer.hpp"
 #include "SH3/system/log.hpp"
 
+#include <cstddef>
 #include <cstring>
+#include <utility>
 
 using namespace sh3::gl;
 
 CVertexBuffer::CVertexBuffer()
-    : vboID(VBO_RESET), name("DEFAULT_VERTEX_BUFFER"), target(BufferTarget::ARRAY_BUFFER), data(0x00)
+    : vboID(VBO_RESET), name("DEFAULT_VERTEX_BUFFER"), target(BufferTarget::ARRAY_BUFFER)
 {
     Create();
 }
 
 CVertexBuffer::CVertexBuffer(const std::string& _name)
-    : vboID(VBO_RESET), name(_name), target(BufferTarget::ARRAY_BUFFER), data(0x00)
+    : vboID(VBO_RESET), name(_name), target(BufferTarget::ARRAY_BUFFER)
 {
     Create();
 }
 
+CVertexBuffer::CVertexBuffer(CVertexBuffer&& rhs) noexcept
+    : vboID(rhs.vboID), name(std::move(rhs.name)), target(rhs.target), mapOffset(rhs.mapOffset), mapLength(rhs.mapLength), mapAccess(rhs.mapAccess)
+#if SH3_GL_SHADOW_COPY
+    , data(std::move(rhs.data))
+#endif
+{
+    rhs.vboID = VBO_RESET;
+    rhs.mapLength = 0;
+}
+
+CVertexBuffer& CVertexBuffer::operator=(CVertexBuffer&& rhs) noexcept
+{
+    if(this != &rhs)
+    {
+        Destroy();
+        vboID = rhs.vboID;
+        name = std::move(rhs.name);
+        target = rhs.target;
+        mapOffset = rhs.mapOffset;
+        mapLength = rhs.mapLength;
+        mapAccess = rhs.mapAccess;
+#if SH3_GL_SHADOW_COPY
+        data = std::move(rhs.data);
+#endif
+        rhs.vboID = VBO_RESET;
+        rhs.mapLength = 0;
+    }
+    return *this;
+}
+
 CVertexBuffer::~CVertexBuffer()
 {
     Destroy();
@@ -35,15 +67,19 @@ CVertexBuffer::~CVertexBuffer()
 
 void CVertexBuffer::Create(void) noexcept
 {
-    glGenBuffers(1, &vboID);
+    glCreateBuffers(1, &vboID); // Not glGenBuffers, the buffer has to exist for the glNamedBuffer* functions
 }
 
 void CVertexBuffer::Destroy(void) noexcept
 {
     // Free memory from both contexts
-    glDeleteBuffers(1, &vboID);
+    glDeleteBuffers(1, &vboID); // Deleting 0 (a moved-from buffer) is ignored
+    vboID = VBO_RESET;
+    mapLength = 0;
+#if SH3_GL_SHADOW_COPY
     data.clear();
     data.shrink_to_fit();
+#endif
 }
 
 void CVertexBuffer::Bind() const noexcept
@@ -64,8 +100,11 @@ void CVertexBuffer::BufferData(BufferTarget target, GLsizeiptr size, const GLvoi
     Bind();
     glBufferData(target, size, data, usage);
 
-    this->data.resize(size);
-    std::memcpy(this->data.data(), reinterpret_cast<const GLubyte*>(data), size);
+#if SH3_GL_SHADOW_COPY
+    this->data.assign(static_cast<std::size_t>(size), 0);
+    if(data != nullptr)
+        std::memcpy(this->data.data(), data, static_cast<std::size_t>(size));
+#endif
 
     this->target = target;
 }
@@ -74,8 +113,11 @@ void CVertexBuffer::BufferData(GLsizeiptr size, const GLvoid* data, BufferUsage
 {
     glNamedBufferData(vboID, size, data, usage);
 
-    this->data.resize(size);
-    std::memcpy(this->data.data(), reinterpret_cast<const GLubyte*>(data), size);
+#if SH3_GL_SHADOW_COPY
+    this->data.assign(static_cast<std::size_t>(size), 0);
+    if(data != nullptr)
+        std::memcpy(this->data.data(), data, static_cast<std::size_t>(size));
+#endif
 }
 
 void CVertexBuffer::BufferSubData(BufferTarget target, GLintptr offset, GLsizeiptr size, const GLvoid* data)
@@ -83,14 +125,60 @@ void CVertexBuffer::BufferSubData(BufferTarget target, GLintptr offset, GLsizeip
     Bind();
     glBufferSubData(target, offset, size, data);
 
-    std::memcpy(this->data.data() + offset, reinterpret_cast<const GLubyte*>(data), size);
+#if SH3_GL_SHADOW_COPY
+    if(static_cast<std::size_t>(offset + size) <= this->data.size())
+        std::memcpy(this->data.data() + offset, data, static_cast<std::size_t>(size));
+#endif
     this->target = target;
-
 }
 
 void CVertexBuffer::BufferSubData(GLintptr offset, GLsizeiptr size, const GLvoid* data)
 {
     glNamedBufferSubData(vboID, offset, size, data);
 
-    std::memcpy(this->data.data() + offset, reinterpret_cast<const GLubyte*>(data), size);
+#if SH3_GL_SHADOW_COPY
+    if(static_cast<std::size_t>(offset + size) <= this->data.size())
+        std::memcpy(this->data.data() + offset, data, static_cast<std::size_t>(size));
+#endif
+}
+
+void* CVertexBuffer::Map(GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    if(mapLength != 0)
+    {
+        Log(LogLevel::ERROR, "CVertexBuffer::Map(): CVertexBuffer %s is already mapped!", name.c_str());
+        return nullptr;
+    }
+
+    void* ptr = glMapNamedBufferRange(vboID, offset, length, access);
+    if(ptr == nullptr)
+    {
+        Log(LogLevel::ERROR, "CVertexBuffer::Map(): Unable to map %ld bytes at %ld of CVertexBuffer %s!", static_cast<long>(length), static_cast<long>(offset), name.c_str());
+        return nullptr;
+    }
+
+    mapOffset = offset;
+    mapLength = length;
+    mapAccess = access;
+    return ptr;
+}
+
+bool CVertexBuffer::Unmap()
+{
+    if(mapLength == 0)
+    {
+        Log(LogLevel::WARN, "CVertexBuffer::Unmap(): CVertexBuffer %s is not mapped!", name.c_str());
+        return true;
+    }
+
+    const GLboolean intact = glUnmapNamedBuffer(vboID);
+
+#if SH3_GL_SHADOW_COPY
+    // Whatever was written through the mapping has to be fetched back from the GL
+    if((mapAccess & GL_MAP_WRITE_BIT) && static_cast<std::size_t>(mapOffset + mapLength) <= data.size())
+        glGetNamedBufferSubData(vboID, mapOffset, mapLength, data.data() + mapOffset);
+#endif
+
+    mapLength = 0;
+    return intact == GL_TRUE;
 }
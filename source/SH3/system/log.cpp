@@ -28,17 +28,22 @@ Revision History:
 
 #include <cstdio>
 #include <cstdarg>
+#include <mutex>
 #include <SDL_messagebox.h>
 
 #include <SDL_messagebox.h>
 
 void Log(LogLevel logType, const char* str, ...)
 {
-    static std::FILE* logfile = nullptr;
+    // Log() is called from worker threads (the load_queue workers, reading arc.arc, decoding texture batches),
+    // so the file is only opened once and each message is written in one go
+    static std::FILE*     logfile = nullptr;
+    static std::once_flag opened;
+    static std::mutex     lock;
 
     std::va_list args;
 
-    if(!logfile)
+    std::call_once(opened, []
     {
         static const char* filename = "log.txt";
         if(!(logfile = std::fopen(filename, "w+")))
@@ -47,7 +52,7 @@ void Log(LogLevel logType, const char* str, ...)
             // fallback to stderr then
             logfile = stderr;
         }
-    }
+    });
 
     const char* label = "";
     switch(logType)
@@ -72,6 +77,7 @@ void Log(LogLevel logType, const char* str, ...)
         break;
     }
 
+    std::lock_guard<std::mutex> guard(lock);
     va_start(args, str);
     if(std::fputs(label, logfile) < 0 || std::vfprintf(logfile, str, args) < 0)
     {
@@ -16,6 +16,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <utility>
 
 using namespace sh3::gl;
 
@@ -31,13 +32,40 @@ CShader::CShader(const std::string& _name, const std::vector<ShaderAttribute>& _
     Load();
 }
 
+CShader::CShader(CShader&& rhs) noexcept
+    :   programID(rhs.programID), locked(rhs.locked), name(std::move(rhs.name)), status(rhs.status), attribs(std::move(rhs.attribs))
+{
+    rhs.programID = SHADER_RESET;
+    rhs.locked = false;
+}
+
 CShader::~CShader()
 {
     glDeleteProgram(programID);
 }
 
+CShader& CShader::operator=(CShader&& rhs) noexcept
+{
+    if(this != &rhs)
+    {
+        glDeleteProgram(programID);
+        programID = rhs.programID;
+        locked = rhs.locked;
+        name = std::move(rhs.name);
+        status = rhs.status;
+        attribs = std::move(rhs.attribs);
+        rhs.programID = SHADER_RESET;
+        rhs.locked = false;
+    }
+    return *this;
+}
+
 void CShader::Load(const std::string& _name)
 {
+    // Don't leak the program we had
+    glDeleteProgram(programID);
+    programID = SHADER_RESET;
+
     name = _name;
     Load();
 }
@@ -0,0 +1,368 @@
+/** @file
+ *  Checks of the parts of the engine that don't need a window or an OpenGL context.
+ *
+ *  Returns a non-zero exit status if any check fails.
+ *
+ *  @copyright 2016-2019 Palm Studios
+ */
+#include "SH3/arc/file_index.hpp"
+#include "SH3/arc/file_table.hpp"
+#include "SH3/arc/mft_cache.hpp"
+#include "SH3/arc/subarc.hpp"
+#include "SH3/graphics/palette.hpp"
+#include "SH3/graphics/swizzle.hpp"
+#include "SH3/system/exit_code.hpp"
+#include "SH3/types/color.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+int failures = 0; /**< Number of failed checks. */
+
+/**
+ *  Report a failed check.
+ */
+void Check(bool ok, const char* what)
+{
+    if(!ok)
+    {
+        std::printf("FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+/**
+ *  The unswizzling loop of @c CTexture::Load before it was turned into a table, writing into a larger image
+ *  (the old loop didn't check any bounds).
+ *
+ *  @returns The number of indices read from @p src.
+ */
+std::size_t UnswizzleReference(const std::vector<std::uint8_t>& src, std::vector<std::uint8_t>& image, std::uint16_t width, std::uint16_t height)
+{
+    std::size_t pos = 0;
+    std::uint32_t x = 0;
+    std::uint32_t y = 0;
+    bool offsetFlipper = false;
+
+    while(true)
+    {
+        for(unsigned i = 0; i < 32; ++i)
+        {
+            const std::uint8_t index = src[pos++];
+
+            auto xoffset = static_cast<std::uint8_t>(((i << 2) & 0xfu) + ((i >> 2) & 0xfu));
+            if(i > 16 && i % 2u)
+            {
+                xoffset ^= 8u;
+                xoffset &= 0xfu;
+            }
+            if(offsetFlipper)
+            {
+                xoffset ^= 4u;
+            }
+
+            const auto tempx = x + xoffset - 16;
+            const auto tempy = y + ((i % 2u) ? 2u : 0u);
+
+            const std::size_t dst = (width * tempy) + tempx % width;
+            if(dst < image.size())
+            {
+                image[dst] = index;
+            }
+        }
+
+        x += 16;
+        if(x < width)
+        {
+            continue;
+        }
+
+        x = 0;
+
+        ++y;
+        if(y % 2 == 0)
+        {
+            y += 2;
+
+            if(y >= height)
+            {
+                break;
+            }
+
+            offsetFlipper = !offsetFlipper;
+        }
+
+        if(y == height)
+        {
+            break;
+        }
+    }
+    return pos;
+}
+
+void TestUnswizzle()
+{
+    static const std::pair<std::uint16_t, std::uint16_t> sizes[] = {{128, 64}, {512, 512}, {16, 4}, {24, 8}, {40, 12}, {64, 6}};
+
+    std::mt19937 rng(1);
+    for(const auto& size : sizes)
+    {
+        const std::uint16_t width = size.first;
+        const std::uint16_t height = size.second;
+        const std::size_t numPixels = static_cast<std::size_t>(width) * height;
+
+        std::vector<std::uint8_t> src(numPixels * 4);
+        std::generate(src.begin(), src.end(), [&rng]{return static_cast<std::uint8_t>(rng());});
+
+        // The old loop wrote up to two lines past the image
+        std::vector<std::uint8_t> expected(numPixels + 4 * static_cast<std::size_t>(width), 0xcd);
+        const std::size_t numRead = UnswizzleReference(src, expected, width, height);
+        expected.resize(numPixels);
+
+        const auto table = sh3::graphics::GetUnswizzleTable(width, height);
+        std::vector<std::uint8_t> image(numPixels, 0xcd);
+        sh3::graphics::Unswizzle8(src.data(), src.size(), image.data(), image.size(), *table);
+
+        std::printf("unswizzle %ux%u\n", width, height);
+        Check(table->size() == numRead, "the table covers as many indices as the old loop read");
+        Check(image == expected, "the table puts every index where the old loop did");
+        Check(sh3::graphics::GetUnswizzleTable(width, height) == table, "tables are kept per size");
+    }
+}
+
+void TestPalette()
+{
+    // The swapping CTexture::Load did in place before BuildPalette existed
+    std::vector<rgba> colors(256);
+    for(std::size_t i = 0; i < colors.size(); ++i)
+    {
+        colors[i] = {static_cast<std::uint8_t>(i), static_cast<std::uint8_t>(255 - i), static_cast<std::uint8_t>(i * 7), static_cast<std::uint8_t>(i)};
+    }
+    std::vector<rgba> expected = colors;
+    for(auto iter = std::next(expected.begin(), 8); static_cast<std::size_t>(std::distance(iter, expected.end())) > 32; std::advance(iter, 32))
+    {
+        std::swap_ranges(iter, std::next(iter, 8), std::next(iter, 8));
+    }
+
+    const sh3::graphics::expanded_palette palette = sh3::graphics::BuildPalette(colors);
+    bool same = true;
+    for(std::size_t i = 0; i < palette.size(); ++i)
+    {
+        const int alpha = std::min(expected[i].a * 2, 0xff);
+        same = same && palette[i].r == expected[i].r && palette[i].g == expected[i].g && palette[i].b == expected[i].b && palette[i].a == alpha;
+    }
+    std::printf("palette\n");
+    Check(same, "BuildPalette swaps every other group of 8 colors and scales the alpha");
+    Check(palette[8].r == 16 && palette[16].r == 8 && palette[40].r == 48, "colors 8-15 and 16-23 trade places");
+
+    const sh3::graphics::expanded_palette small = sh3::graphics::BuildPalette(std::vector<rgba>(4, rgba{1, 2, 3, 0x80}));
+    Check(small[3].a == 0xff && small[4].r == 0 && small[4].a == 0, "entries past the colors are black");
+}
+
+/**
+ *  Paths, subarcs and records for the file table and index tests.
+ */
+struct fake_arc
+{
+    std::string                        arena;        /**< Paths of all files. */
+    std::vector<sh3::arc::file_record> records;      /**< Records of all files. */
+    std::vector<std::size_t>           firstRecords; /**< Position of the first record of each subarc. */
+
+    /**
+     *  Add a subarc. Its files have to be sorted by path.
+     */
+    void AddSubarc(const std::vector<std::string>& paths)
+    {
+        firstRecords.push_back(records.size());
+        for(std::size_t i = 0; i < paths.size(); ++i)
+        {
+            records.push_back({static_cast<std::uint32_t>(arena.size()), static_cast<std::uint16_t>(paths[i].size()), static_cast<std::uint16_t>(i + 10)});
+            arena += paths[i];
+        }
+    }
+
+    sh3::arc::file_table GetFiles(std::size_t sub) const
+    {
+        const std::size_t end = sub + 1 < firstRecords.size() ? firstRecords[sub + 1] : records.size();
+        return sh3::arc::file_table(arena.data(), records.data() + firstRecords[sub], end - firstRecords[sub]);
+    }
+};
+
+void TestFileTable()
+{
+    fake_arc arc;
+    arc.AddSubarc({"data/a.tex", "data/b.tex", "data/bb.tex", "data/c/d.tex"});
+
+    const sh3::arc::file_table files = arc.GetFiles(0);
+    const sh3::arc::file_record* found = files.Find("data/bb.tex");
+
+    std::printf("file_table\n");
+    Check(files.size() == 4, "file_table has all records");
+    Check(found != nullptr && found->index == 12 && files.GetName(*found) == "data/bb.tex", "file_table finds a path");
+    Check(files.Find("data/a.tex") == files.begin() && files.Find("data/c/d.tex") == std::prev(files.end()), "file_table finds the first and last path");
+    Check(files.Find("data/b") == nullptr && files.Find("data/bc.tex") == nullptr && files.Find("") == nullptr && files.Find("z") == nullptr, "file_table misses paths it doesn't hold");
+    Check(sh3::arc::file_table().Find("data/a.tex") == nullptr, "an empty file_table finds nothing");
+}
+
+void TestFileIndex()
+{
+    fake_arc arc;
+    std::vector<std::string> many;
+    for(int i = 0; i < 1000; ++i)
+    {
+        many.push_back("data/many/" + std::to_string(i));
+    }
+    std::sort(many.begin(), many.end());
+    arc.AddSubarc({"data/a.tex", "data/shared.tex"});
+    arc.AddSubarc({"data/shared.tex", "data/z.tex"});
+    arc.AddSubarc(many);
+
+    sh3::arc::file_index index(arc.arena.data());
+    index.Reserve(4);
+    bool inserted = true;
+    std::size_t numInserted = 0;
+    for(std::size_t sub = 0; sub < 3; ++sub)
+    {
+        for(const sh3::arc::file_record& record : arc.GetFiles(sub))
+        {
+            const bool isNew = index.Insert(record, static_cast<sh3::arc::file_index::subarc_id>(sub));
+            numInserted += isNew;
+            inserted = inserted && (isNew || arc.GetFiles(sub).GetName(record) == "data/shared.tex");
+        }
+    }
+
+    std::printf("file_index\n");
+    Check(inserted && numInserted == 1003 && index.GetSize() == 1003, "file_index only rejects the duplicate path");
+    Check(index.GetCapacity() >= 2 * index.GetSize() && (index.GetCapacity() & (index.GetCapacity() - 1)) == 0, "file_index grows to a power of two, at most half full");
+
+    const sh3::arc::file_index::entry* shared = index.Find("data/shared.tex");
+    Check(shared != nullptr && shared->subarc == 0 && shared->index == 11, "the first subarc holding a path wins");
+    const sh3::arc::file_index::entry* z = index.Find("data/z.tex");
+    Check(z != nullptr && z->subarc == 1 && z->index == 11 && index.GetName(*z) == "data/z.tex", "file_index finds a path");
+
+    bool allFound = true;
+    for(std::size_t i = 0; i < many.size(); ++i)
+    {
+        const sh3::arc::file_index::entry* e = index.Find(many[i]);
+        allFound = allFound && e != nullptr && e->subarc == 2 && e->index == i + 10;
+    }
+    Check(allFound, "file_index finds every path after growing");
+    Check(index.Find("data/many/1000") == nullptr && index.Find("") == nullptr, "file_index misses paths it doesn't hold");
+    Check(sh3::arc::file_index().Find("data/a.tex") == nullptr, "an empty file_index finds nothing");
+
+    const sh3::arc::file_index view(arc.arena.data(), index.GetSlots(), index.GetCapacity(), index.GetSize());
+    const sh3::arc::file_index::entry* viewed = view.Find("data/many/500");
+    Check(viewed != nullptr && viewed->subarc == 2 && view.GetName(*viewed) == "data/many/500", "a file_index can view stored slots");
+}
+
+void TestMftCache()
+{
+    static const char* path = "unit_test.idx";
+
+    fake_arc arc;
+    arc.AddSubarc({"data/a.tex", "data/shared.tex"});
+    arc.AddSubarc({"data/shared.tex", "data/z.tex"});
+
+    std::vector<sh3::arc::subarc> subarcs;
+    subarcs.emplace_back("sub0", arc.GetFiles(0));
+    subarcs.emplace_back("sub1", arc.GetFiles(1));
+
+    sh3::arc::mft_cache::digest digest;
+    digest.size = 1234;
+    digest.crc = 0xdeadbeef;
+
+    std::printf("mft_cache\n");
+    Check(sh3::arc::mft_cache::Write(path, digest, subarcs), "mft_cache is written");
+
+    std::size_t numSlots = 0;
+    {
+        sh3::arc::mft_cache cache;
+        Check(cache.Open(path, digest), "mft_cache opens what it wrote");
+        numSlots = cache.GetIndex().GetCapacity();
+        Check(cache.GetSubarcCount() == 2 && cache.GetFileCount() == 4, "mft_cache holds all subarcs and files");
+        if(cache.GetSubarcCount() == 2)
+        {
+            const sh3::arc::mft_cache::subarc_record& sub = cache.GetSubarc(1);
+            Check(cache.GetString(sub.name, sub.nameLength) == "sub1", "mft_cache keeps the subarc names");
+            const sh3::arc::file_record* z = cache.GetFileTable(sub).Find("data/z.tex");
+            Check(z != nullptr && z->index == 11, "the file tables of mft_cache can be searched");
+
+            const sh3::arc::file_index index = cache.GetIndex();
+            const sh3::arc::file_index::entry* shared = index.Find("data/shared.tex");
+            Check(index.GetSize() == 3 && shared != nullptr && shared->subarc == 0 && index.Find("data/z.tex") != nullptr, "the file index of mft_cache can be searched");
+        }
+
+        sh3::arc::mft_cache::digest other = digest;
+        other.crc ^= 1;
+        Check(!sh3::arc::mft_cache().Open(path, other), "mft_cache of another arc.arc is ignored");
+    }
+
+    std::vector<char> contents;
+    {
+        std::ifstream in(path, std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    const auto writeFile = [](const std::vector<char>& data)
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    };
+
+    // Cut off the last byte of the string table
+    std::vector<char> truncated(contents.begin(), std::prev(contents.end()));
+    writeFile(truncated);
+    Check(!sh3::arc::mft_cache().Open(path, digest), "a truncated mft_cache is ignored");
+
+    // Point every occupied index slot at a subarc that doesn't exist. The slots are right before the string table,
+    // which holds the names of the two subarcs and the four files.
+    const std::size_t stringsSize = 8 + arc.arena.size();
+    const std::size_t slotsStart = contents.size() - stringsSize - numSlots * sizeof(sh3::arc::file_index::entry);
+    std::vector<char> corrupt = contents;
+    bool patched = false;
+    for(std::size_t i = 0; i < numSlots; ++i)
+    {
+        char* const pos = &corrupt[slotsStart + i * sizeof(sh3::arc::file_index::entry)];
+        sh3::arc::file_index::entry slot;
+        std::copy_n(pos, sizeof(slot), reinterpret_cast<char*>(&slot));
+        if(slot.subarc != sh3::arc::file_index::noSubarc)
+        {
+            slot.subarc = 7;
+            std::copy_n(reinterpret_cast<const char*>(&slot), sizeof(slot), pos);
+            patched = true;
+        }
+    }
+    writeFile(corrupt);
+    Check(patched && !sh3::arc::mft_cache().Open(path, digest), "an mft_cache with a broken index is ignored");
+
+    std::remove(path);
+}
+}
+
+int main()
+{
+    TestUnswizzle();
+    TestPalette();
+    TestFileTable();
+    TestFileIndex();
+    TestMftCache();
+
+    if(failures != 0)
+    {
+        std::printf("%d check(s) failed\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    std::printf("All checks passed\n");
+    return static_cast<int>(exit_code::SUCCESS);
+}